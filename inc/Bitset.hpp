@@ -0,0 +1,152 @@
+#ifndef BITSET_HPP_
+#define BITSET_HPP_
+
+#include <boost/functional/hash.hpp>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+using std::vector;
+
+/*
+ * Dynamic fixed-size bitset over local indices 0..size-1. Operations between two bitsets assume that both
+ * have the same size.
+ */
+class Bitset {
+	vector<uint64_t> words;
+	int nbits;
+
+      public:
+	Bitset() : nbits(0) {
+	}
+
+	Bitset(int n) : words((n + 63) / 64, 0), nbits(n) {
+	}
+
+	int size() const {
+		return this->nbits;
+	}
+
+	void set(int i) {
+		this->words[i >> 6] |= (uint64_t)1 << (i & 63);
+	}
+
+	void reset(int i) {
+		this->words[i >> 6] &= ~((uint64_t)1 << (i & 63));
+	}
+
+	bool test(int i) const {
+		return (this->words[i >> 6] >> (i & 63)) & 1;
+	}
+
+	/* Set every bit in 0..size-1 */
+	void fill() {
+		for (uint64_t &w : this->words) {
+			w = ~(uint64_t)0;
+		}
+		if (this->nbits & 63) {
+			this->words.back() = ((uint64_t)1 << (this->nbits & 63)) - 1;
+		}
+	}
+
+	void clear() {
+		for (uint64_t &w : this->words) {
+			w = 0;
+		}
+	}
+
+	/* Complement within 0..size-1 */
+	void flip() {
+		for (uint64_t &w : this->words) {
+			w = ~w;
+		}
+		if (this->nbits & 63) {
+			this->words.back() &= ((uint64_t)1 << (this->nbits & 63)) - 1;
+		}
+	}
+
+	int count() const {
+		int cnt = 0;
+		for (uint64_t w : this->words) {
+			cnt += __builtin_popcountll(w);
+		}
+		return cnt;
+	}
+
+	/* |this & other| */
+	int count_and(const Bitset &other) const {
+		int cnt = 0;
+		for (size_t i = 0; i < this->words.size(); i++) {
+			cnt += __builtin_popcountll(this->words[i] & other.words[i]);
+		}
+		return cnt;
+	}
+
+	bool any() const {
+		for (uint64_t w : this->words) {
+			if (w) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	Bitset &operator&=(const Bitset &other) {
+		for (size_t i = 0; i < this->words.size(); i++) {
+			this->words[i] &= other.words[i];
+		}
+		return *this;
+	}
+
+	Bitset &operator|=(const Bitset &other) {
+		for (size_t i = 0; i < this->words.size(); i++) {
+			this->words[i] |= other.words[i];
+		}
+		return *this;
+	}
+
+	/* Set difference: this & ~other */
+	Bitset &operator-=(const Bitset &other) {
+		for (size_t i = 0; i < this->words.size(); i++) {
+			this->words[i] &= ~other.words[i];
+		}
+		return *this;
+	}
+
+	bool operator==(const Bitset &other) const {
+		return this->nbits == other.nbits && this->words == other.words;
+	}
+
+	/* Lowest set bit, or -1 if none */
+	int first() const {
+		for (size_t i = 0; i < this->words.size(); i++) {
+			if (this->words[i]) {
+				return (int)(i * 64 + __builtin_ctzll(this->words[i]));
+			}
+		}
+		return -1;
+	}
+
+	/* Calls f(i) for every set bit i, in increasing order */
+	template <typename F> void forall(F f) const {
+		for (size_t i = 0; i < this->words.size(); i++) {
+			uint64_t w = this->words[i];
+			while (w) {
+				f((int)(i * 64 + __builtin_ctzll(w)));
+				w &= w - 1;
+			}
+		}
+	}
+
+	const vector<uint64_t> &data() const {
+		return this->words;
+	}
+};
+
+inline std::size_t hash_value(const Bitset &b) {
+	return boost::hash_range(b.data().begin(), b.data().end());
+}
+
+typedef std::unordered_set<Bitset, boost::hash<Bitset>> BitsetSet;
+
+#endif
@@ -1,14 +1,20 @@
 #ifndef GRAPH_HPP_
 #define GRAPH_HPP_
 
+#include <algorithm>
 #include <boost/functional/hash.hpp>
 #include <functional>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
+#include <Bitset.hpp>
+#include <IntervalIndex.hpp>
+#include <scheduler.hpp>
+
 using std::function;
 using std::map;
 using std::pair;
@@ -62,25 +68,142 @@ struct TEdge {
 	}
 };
 
+class GraphFileReader;
+class GraphFileWriter;
+
 std::size_t hash_value(SEdge const& e);
 
 std::size_t hash_value(TEdge const& e);
 
+/*
+ * Sorted set of node ids with a NodeId -> dense index lookup: a direct table when the id range is compact,
+ * binary search otherwise. Dense indices follow the NodeId order.
+ */
+class NodeIndex {
+	vector<NodeId> ids;
+	NodeId base;
+	vector<int> table;
+
+      public:
+	NodeIndex();
+
+	/* nodes may be unsorted and contain duplicates */
+	NodeIndex(vector<NodeId> nodes);
+
+	int size() const;
+
+	int index(NodeId node) const;
+
+	NodeId nodeId(int idx) const;
+
+	const vector<NodeId> &getIds() const;
+};
+
+inline int NodeIndex::size() const {
+	return (int)(this->ids.size());
+}
+
+inline int NodeIndex::index(NodeId node) const {
+	if (!this->table.empty()) {
+		size_t off = (size_t)((long)node - (long)this->base);
+		return off < this->table.size() ? this->table[off] : -1;
+	}
+
+	auto it = std::lower_bound(this->ids.begin(), this->ids.end(), node);
+	return (it != this->ids.end() && *it == node) ? (int)(it - this->ids.begin()) : -1;
+}
+
+inline NodeId NodeIndex::nodeId(int idx) const {
+	return this->ids[idx];
+}
+
+inline const vector<NodeId> &NodeIndex::getIds() const {
+	return this->ids;
+}
+
+/*
+ * Static graph stored as an immutable compressed sparse row structure. Nodes are remapped to the dense
+ * indices 0..n-1 in increasing NodeId order, and the neighbours of each node are kept as a sorted array of
+ * dense indices.
+ *
+ * The CSR storage is shared between copies. A graph may also be an overlay of another one: a few rows are
+ * replaced by rows stored in the overlay itself, while every other row is read from the shared base.
+ */
 class SGraph {
-	map<NodeId, unordered_set<SEdge, boost::hash<SEdge>>> adj_list;
+	struct CSR {
+		NodeIndex nodes;
+		vector<int> offsets;
+		vector<int> adj;
+
+		/* Connected components: label of every dense index, and the dense indices grouped by label */
+		vector<int> component;
+		vector<int> component_offsets;
+		vector<int> component_nodes;
+	};
+
+	std::shared_ptr<const CSR> csr;
+
+	/* Overlay rows: sorted dense indices of the replaced nodes and their rows */
+	vector<int> overlay_nodes;
+	vector<int> overlay_offsets;
+	vector<int> overlay_adj;
+
+	void build(vector<NodeId> &nodes, const vector<SEdge> &edgeList);
+
+	int overlayRow(int idx) const;
+
+	/*
+	 * Labels the connected components reached from starts, numbered in order of discovery; label[i] stays -1
+	 * for the unreached dense indices. Returns the number of components.
+	 */
+	int labelComponents(const vector<int> &starts, vector<int> &label) const;
 
       public:
 	SGraph();
 
-	SGraph(vector<SEdge> &edgeList);
+	SGraph(const vector<SEdge> &edgeList);
+
+	SGraph(const vector<NodeId> &nodes, const vector<SEdge> &edgeList);
+
+	/*
+	 * Overlay of base where the row of each node in rows is replaced by the given sorted dense neighbour
+	 * indices. The caller keeps the graph undirected, i.e. the new rows agree with the other rows of base.
+	 */
+	SGraph(const SGraph &base, const map<int, vector<int>> &rows);
+
+	/* Graph stored in a graph file (see GraphFile.hpp) */
+	SGraph(GraphFileReader &in);
+
+	/* Stores the graph in a graph file; overlays are not supported */
+	void write(GraphFileWriter &out) const;
+
+	int index(NodeId node) const;
 
-	SGraph(unordered_set<SEdge, boost::hash<SEdge>> &edgeList);
+	NodeId nodeId(int idx) const;
 
-	SGraph(const SGraph &g2);
+	/* Sorted dense neighbour indices of the node with dense index idx */
+	const int *rowBegin(int idx) const;
 
-	void addNode(NodeId n);
+	const int *rowEnd(int idx) const;
 
-	void addEdge(SEdge e);
+	struct Row {
+		const int *first, *last;
+
+		const int *begin() const {
+			return this->first;
+		}
+
+		const int *end() const {
+			return this->last;
+		}
+
+		int size() const {
+			return (int)(this->last - this->first);
+		}
+	};
+
+	/* Same as above, as a range: for (int v : g.row(u)) { ... } */
+	Row row(int idx) const;
 
 	int getNodesCount();
 
@@ -108,36 +231,212 @@ class SGraph {
 
 	void forallNeighbours(NodeId node, function<void(NodeId)> callback, bool parallel);
 
+	/* Visitor overloads of the above: the callback is called directly, so that it can be inlined */
+	template <typename F> void forallNodes(F callback, bool parallel);
+
+	template <typename F> void forallNeighbours(NodeId node, F callback, bool parallel);
+
 	NodeSet getNodes();
 
 	bool hasEdge(NodeId u, NodeId v);
 
 	bool isConnected(const NodeSet &subset);
 
+	/* Connected component of u, or {u} if u is not in the graph */
 	NodeSet getReachableNodes(NodeId u);
 
+	/* Nodes within radius hops of some node of centers, centers included */
+	NodeSet ball(const NodeSet &centers, int radius);
+
+	/* Nodes within radius hops of every node of centers; every node if centers is empty */
+	NodeSet commonBall(const NodeSet &centers, int radius);
+
+	/*
+	 * Partition of nodes by connected component, ordered by smallest node. Components are precomputed with
+	 * the graph storage; overlays label the components of nodes on demand.
+	 */
+	vector<NodeSet> groupByComponent(const NodeSet &nodes);
+
+	/*
+	 * Largest subset of restriction in which every node u keeps at least required(degree(u)) neighbours,
+	 * found by repeatedly peeling the nodes that fall short of their bound.
+	 */
+	NodeSet peel(const NodeSet &restriction, function<int(int)> required);
+
 	bool isKplex(const NodeSet &plex, int k);
 
 	int outdegree_sum(const NodeSet &restriction);
 };
 
+inline int SGraph::index(NodeId node) const {
+	return this->csr->nodes.index(node);
+}
+
+inline NodeId SGraph::nodeId(int idx) const {
+	return this->csr->nodes.nodeId(idx);
+}
+
+inline int SGraph::overlayRow(int idx) const {
+	auto it = std::lower_bound(this->overlay_nodes.begin(), this->overlay_nodes.end(), idx);
+	return (it != this->overlay_nodes.end() && *it == idx) ? (int)(it - this->overlay_nodes.begin()) : -1;
+}
+
+inline const int *SGraph::rowBegin(int idx) const {
+	if (!this->overlay_nodes.empty()) {
+		int o = this->overlayRow(idx);
+		if (o >= 0) {
+			return this->overlay_adj.data() + this->overlay_offsets[o];
+		}
+	}
+
+	return this->csr->adj.data() + this->csr->offsets[idx];
+}
+
+inline const int *SGraph::rowEnd(int idx) const {
+	if (!this->overlay_nodes.empty()) {
+		int o = this->overlayRow(idx);
+		if (o >= 0) {
+			return this->overlay_adj.data() + this->overlay_offsets[o + 1];
+		}
+	}
+
+	return this->csr->adj.data() + this->csr->offsets[idx + 1];
+}
+
+inline SGraph::Row SGraph::row(int idx) const {
+	if (!this->overlay_nodes.empty()) {
+		int o = this->overlayRow(idx);
+		if (o >= 0) {
+			const int *adj = this->overlay_adj.data();
+			return Row{adj + this->overlay_offsets[o], adj + this->overlay_offsets[o + 1]};
+		}
+	}
+
+	const int *adj = this->csr->adj.data();
+	return Row{adj + this->csr->offsets[idx], adj + this->csr->offsets[idx + 1]};
+}
+
+template <typename F> void SGraph::forallNodes(F callback, bool parallel) {
+	const vector<NodeId> &ids = this->csr->nodes.getIds();
+	if (parallel) {
+		scheduler::parallel_for((long)(ids.size()), [&](long i) { callback(ids[i]); });
+	} else {
+		for (NodeId u : ids) {
+			callback(u);
+		}
+	}
+}
+
+template <typename F> void SGraph::forallNeighbours(NodeId node, F callback, bool parallel) {
+	int u = this->index(node);
+	if (u < 0) {
+		return;
+	}
+
+	Row r = this->row(u);
+	if (parallel) {
+		scheduler::parallel_for((long)(r.size()), [&](long i) { callback(this->nodeId(r.first[i])); });
+	} else {
+		for (int v : r) {
+			callback(this->nodeId(v));
+		}
+	}
+}
+
+/*
+ * Adjacency bit-matrix of the subgraph induced by a (small) node set. Nodes are indexed locally as
+ * 0..size-1 in increasing NodeId order; row i holds the local neighbours of node i. The degree of every node
+ * in the whole graph is kept as well, so that out-degrees with respect to local sets can be computed with a
+ * single AND + popcount.
+ */
+class AdjMatrix {
+	vector<NodeId> nodes;
+	vector<Bitset> rows;
+	vector<int> degrees;
+
+      public:
+	AdjMatrix();
+
+	AdjMatrix(SGraph &g, const NodeSet &restriction);
+
+	int size() const;
+
+	NodeId nodeId(int i) const;
+
+	int index(NodeId node) const;
+
+	bool hasEdge(int i, int j) const;
+
+	const Bitset &row(int i) const;
+
+	/* Degree in the induced subgraph */
+	int degree(int i) const;
+
+	/* Degree in the whole graph */
+	int globalDegree(int i) const;
+
+	int degree(int i, const Bitset &restriction) const;
+
+	int outdegree(int i, const Bitset &in) const;
+
+	int outdegree_sum(const Bitset &restriction) const;
+
+	bool isKplex(const Bitset &plex, int k) const;
+
+	Bitset toBitset(const NodeSet &nodeset) const;
+
+	NodeSet toNodeSet(const Bitset &bits) const;
+
+	/* Complement graph on the same node set, without self loops; global degrees become complement degrees */
+	AdjMatrix complement() const;
+
+	SGraph toGraph() const;
+};
+
+/*
+ * Temporal graph. Nodes are remapped to dense indices as in SGraph; the temporal edges of every node are kept
+ * in a contiguous slice sorted by start time, augmented as an implicit interval tree (see IntervalIndex.hpp)
+ * so that the edges alive at an instant, or overlapping a window, are found in O(log d + answer).
+ */
 class TGraph {
-	map<NodeId, unordered_set<TEdge, boost::hash<TEdge>>> adj_list;
+	NodeIndex nodes;
+	vector<int> offsets;
+	vector<TEdge> edges;
+	vector<NodeTime> max_stop;
 	NodeTime lifetime_begin, lifetime_end;
 
+	/*
+	 * Every undirected edge once, sorted by start time and indexed the same way: a query with lo = t_stop and
+	 * hi = t_start is a 2-D dominance query returning exactly the edges alive throughout [t_start, t_stop].
+	 */
+	vector<TEdge> all_edges;
+	vector<NodeTime> all_max_stop;
+
+	/* Calls f(e) for every edge e of node with e.tStart <= hi and e.tStop >= lo */
+	template <typename F> void query(NodeId node, NodeTime lo, NodeTime hi, F f);
+
+	/* Calls f(e) once for every undirected edge e alive throughout [t_start, t_stop] */
+	template <typename F> void queryContaining(NodeTime t_start, NodeTime t_stop, F f);
+
+	void intersectionEdges(const NodeSet &restriction, NodeTime t_start, NodeTime t_stop, vector<SEdge> &edges);
+
+	friend class WindowSweep;
+
       public:
 	TGraph();
 
 	TGraph(vector<TEdge> &edgeList);
 
-	TGraph(const TGraph &g2);
+	/* Graph stored in a graph file (see GraphFile.hpp) */
+	TGraph(GraphFileReader &in);
 
-	void addNode(NodeId n);
-
-	void addEdge(TEdge e);
+	void write(GraphFileWriter &out) const;
 
 	void forallNeighbours(NodeId node, NodeTime t, function<void(NodeId &)> callback, bool parallel);
 
+	/* Visitor overload of the above: the callback is called directly, so that it can be inlined */
+	template <typename F> void forallNeighbours(NodeId node, NodeTime t, F callback, bool parallel);
+
 	int getNodesCount();
 
 	int getEdgesCount();
@@ -150,10 +449,28 @@ class TGraph {
 
 	NodeSet getNodes();
 
+	/* Maximal intervals during which at least one edge is alive, in increasing order */
+	vector<Interval> getActiveIntervals();
+
+	/* Same as above, clipped to [t_from, t_to]; only the edges overlapping it are visited */
+	vector<Interval> getActiveIntervals(NodeTime t_from, NodeTime t_to);
+
+	/* Same as above, for the edges of node only */
+	vector<Interval> getActiveIntervals(NodeId node, NodeTime t_from, NodeTime t_to);
+
 	SGraph buildIntersectionGraph(const NodeSet &restriction, NodeTime t_start, NodeTime t_stop);
 
+	/* Intersection graph of [t_start, t_stop] over every node, with the same dense indices as this graph */
+	SGraph buildWindowGraph(NodeTime t_start, NodeTime t_stop);
+
 	SGraph buildAuxGraph(const NodeSet &restriction, NodeTime t_start, NodeTime t_stop, NodeTime t_crit);
 
+	/*
+	 * Same as above, given the window graph of [t_start, t_stop]: the rows of the restriction are replaced in
+	 * an overlay, so the window graph is shared rather than copied.
+	 */
+	SGraph buildAuxGraph(const SGraph &window, const NodeSet &restriction, NodeTime t_crit);
+
 	int outdegree(NodeId node, const NodeSet &in, NodeTime t);
 
 	int outdegree_max(NodeId node, const NodeSet &in, NodeTime t_start, NodeTime t_stop);
@@ -164,6 +481,8 @@ class TGraph {
 
 	void forallNodes(function<void(NodeId)> callback, bool parallel);
 
+	template <typename F> void forallNodes(F callback, bool parallel);
+
 	bool isKplex(const NodeSet &plex, int k, NodeTime t_start, NodeTime t_stop);
 
 	int degree(NodeId node, NodeTime t, const NodeSet &restriction);
@@ -173,6 +492,92 @@ class TGraph {
 	map<NodeId, unordered_set<TEdge, boost::hash<TEdge>>> getAdjacencyList();
 };
 
+template <typename F> void TGraph::query(NodeId node, NodeTime lo, NodeTime hi, F f) {
+	int u = this->nodes.index(node);
+	if (u < 0) {
+		return;
+	}
+
+	interval_index::query(this->edges.data() + this->offsets[u], this->max_stop.data() + this->offsets[u],
+			      this->offsets[u + 1] - this->offsets[u], lo, hi, f);
+}
+
+template <typename F> void TGraph::forallNeighbours(NodeId node, NodeTime t, F callback, bool parallel) {
+	if (!parallel) {
+		this->query(node, t, t, [&](const TEdge &e) {
+			NodeId v = e.nodeTo;
+			callback(v);
+		});
+		return;
+	}
+
+	vector<NodeId> neighbours;
+	this->query(node, t, t, [&](const TEdge &e) { neighbours.push_back(e.nodeTo); });
+	scheduler::parallel_for((long)(neighbours.size()), [&](long i) {
+		NodeId v = neighbours[i];
+		callback(v);
+	});
+}
+
+template <typename F> void TGraph::forallNodes(F callback, bool parallel) {
+	const vector<NodeId> &ids = this->nodes.getIds();
+	if (parallel) {
+		scheduler::parallel_for((long)(ids.size()), [&](long i) { callback(ids[i]); });
+	} else {
+		for (NodeId u : ids) {
+			callback(u);
+		}
+	}
+}
+
+/*
+ * Sliding windows [b, b + len - 1] of a temporal graph, for b = b_from, ..., b_to. An edge belongs to the
+ * intersection graph of the window starting at b iff tStart <= b <= tStop - len + 1, so the graph of the next
+ * window is obtained from the current one by inserting the edges starting at b and dropping the ones past the
+ * second bound. Events are applied when a graph is requested, and the SGraph of a window is shared with the
+ * following windows until an edge changes.
+ *
+ *	for (WindowSweep w(g, len, b_from, b_to); !w.done(); w.next()) { ... w.graph() ... }
+ *
+ * Sparse sets of windows are visited with seek(), in increasing order of begin.
+ */
+class WindowSweep {
+	const TGraph &g;
+	NodeTime len, b, b_to;
+
+	/* Next edge of all_edges (sorted by start time) to be inserted, -1 before the first request */
+	int cursor;
+
+	/* Edges of the current window, possibly with expired ones; expiry is their smallest tStop - len + 1 */
+	vector<int> alive;
+	NodeTime expiry;
+
+	SGraph current;
+
+      public:
+	WindowSweep(const TGraph &g, NodeTime len, NodeTime b_from, NodeTime b_to);
+
+	bool done() const;
+
+	void next();
+
+	/* Moves forward to the window starting at b >= begin(), skipping the windows in between */
+	void seek(NodeTime b);
+
+	NodeTime begin() const;
+
+	NodeTime end() const;
+
+	/* Intersection graph of the current window over every node of g */
+	SGraph graph();
+};
+
+/*
+ * Sets of sets that are not a strict subset of another one. Each set is only compared with the larger sets
+ * containing its rarest node.
+ */
+NodeSetSet maximal_sets(const NodeSetSet &sets, bool parallel);
+
 string nodeset_to_string(const NodeSet &nodeset);
 
 string nodesetset_to_string(const NodeSetSet &nodesetset);
@@ -0,0 +1,111 @@
+#ifndef GRAPH_FILE_HPP_
+#define GRAPH_FILE_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <utils.hpp>
+
+using std::ofstream;
+using std::string;
+using std::vector;
+
+/*
+ * Binary graph files, written by the conversion mode of plex (-b) and loaded in place of the text edge lists.
+ * A file is a header followed by the arrays of the graph storage, each one as a 64-bit element count and the
+ * raw elements, padded to 8 bytes. Arrays are stored in native byte order.
+ *
+ * Temporal graphs are stored after preprocessing, so a file only stands for loads with the same squash, -w, -D
+ * and -g parameters.
+ */
+#define GRAPH_FILE_MAGIC "PLEXGRF"
+#define GRAPH_FILE_VERSION 1
+
+enum GraphFileKind { GRAPH_FILE_STATIC = 1, GRAPH_FILE_TEMPORAL = 2 };
+
+struct GraphFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t kind;
+
+	/* Preprocessing parameters of temporal graphs, zero for static ones */
+	int32_t squash, sliding_window, downsample, max_gap;
+};
+
+class GraphFileWriter {
+	ofstream out;
+
+	void raw(const void *data, size_t size);
+
+      public:
+	GraphFileWriter(const string &path, const GraphFileHeader &header);
+
+	bool good() const;
+
+	template <typename T> void write(const vector<T> &array) {
+		static_assert(std::is_trivially_copyable<T>::value, "arrays are written as raw bytes");
+
+		uint64_t count = array.size();
+		this->raw(&count, sizeof(count));
+		this->raw(array.data(), count * sizeof(T));
+
+		static const char zero[8] = {0};
+		this->raw(zero, (8 - count * sizeof(T) % 8) % 8);
+	}
+};
+
+/* Arrays are copied out of the mapped file: no parsing takes place */
+class GraphFileReader {
+	MappedFile file;
+	GraphFileHeader file_header;
+	const char *cursor;
+	bool valid;
+
+      public:
+	GraphFileReader(const string &path);
+
+	/* Whether the file is a graph file of a supported version and no read went past its end */
+	bool good() const;
+
+	template <typename T> vector<T> read() {
+		static_assert(std::is_trivially_copyable<T>::value, "arrays are read as raw bytes");
+
+		uint64_t count = 0;
+		if (this->valid && (size_t)(this->file.end() - this->cursor) >= sizeof(count)) {
+			memcpy(&count, this->cursor, sizeof(count));
+			this->cursor += sizeof(count);
+		} else {
+			this->valid = false;
+		}
+
+		size_t size = count * sizeof(T);
+		if (!this->valid || count > (size_t)(this->file.end() - this->cursor) / sizeof(T)) {
+			this->valid = false;
+			return vector<T>();
+		}
+
+		vector<T> array(count);
+		memcpy((void *)(array.data()), this->cursor, size);
+		this->cursor += std::min(size + (8 - size % 8) % 8, (size_t)(this->file.end() - this->cursor));
+
+		return array;
+	}
+};
+
+/* Whether path is a graph file, i.e. starts with the magic; its header is then stored in header */
+bool read_graph_file_header(const string &path, GraphFileHeader &header);
+
+/* Header of the files of the given kind and preprocessing; -g is ignored on squashed graphs */
+GraphFileHeader graph_file_header(GraphFileKind kind, bool squash, NodeTime sliding_window, NodeTime downsample,
+				  NodeTime max_gap);
+
+SGraph load_sgraph_file(const string &path);
+
+TGraph load_tgraph_file(const string &path, bool squash, NodeTime sliding_window, NodeTime downsample,
+			NodeTime max_gap, Timeline &timeline);
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef INTERVAL_INDEX_HPP_
+#define INTERVAL_INDEX_HPP_
+
+#include <algorithm>
+
+/*
+ * Implicit augmented interval tree over an array of intervals sorted by start time, following the layout of
+ * cgranges (H. Li): the element at index i is a node of level equal to the number of trailing ones of i, its
+ * children are at i -/+ 2^(level-1), and max_stop[i] is the largest stop time in its subtree. The tree needs
+ * no pointers and no extra memory besides max_stop.
+ *
+ * Intervals are closed; T shall expose tStart and tStop.
+ */
+namespace interval_index {
+
+/* Fills max_stop[0..n-1] and returns the level of the root (or -1 on an empty array) */
+template <typename T, typename Time> int build(const T *a, Time *max_stop, long n) {
+	if (n <= 0) {
+		return -1;
+	}
+
+	long i, last_i = 0;
+	Time last = a[0].tStop;
+	for (i = 0; i < n; i += 2) {
+		last_i = i;
+		last = max_stop[i] = a[i].tStop;
+	}
+
+	int k;
+	for (k = 1; 1L << k <= n; k++) {
+		long x = 1L << (k - 1), i0 = (x << 1) - 1, step = x << 2;
+		for (i = i0; i < n; i += step) {
+			Time el = max_stop[i - x];
+			Time er = i + x < n ? max_stop[i + x] : last;
+			max_stop[i] = std::max(a[i].tStop, std::max(el, er));
+		}
+		last_i = (last_i >> k & 1) ? last_i - x : last_i + x;
+		if (last_i < n && max_stop[last_i] > last) {
+			last = max_stop[last_i];
+		}
+	}
+
+	return k - 1;
+}
+
+inline int root_level(long n) {
+	int k = -1;
+	while (n > 0) {
+		n >>= 1;
+		k++;
+	}
+	return k;
+}
+
+/*
+ * Calls f(a[i]) for every interval with tStart <= hi and tStop >= lo, in increasing index order.
+ * With lo == hi == t this is a stabbing query ("alive at t"); with lo = b, hi = a it reports the intervals
+ * containing [a, b].
+ */
+template <typename T, typename Time, typename F>
+void query(const T *a, const Time *max_stop, long n, Time lo, Time hi, F f) {
+	struct frame {
+		long x;
+		int k;
+		bool w;
+	} stack[64];
+	int t = 0;
+
+	if (n <= 0) {
+		return;
+	}
+
+	int root_k = root_level(n);
+	stack[t++] = {(1L << root_k) - 1, root_k, false};
+
+	while (t) {
+		frame z = stack[--t];
+		if (z.k <= 3) {
+			/* Small subtree: scan it linearly */
+			long i0 = z.x >> z.k << z.k, i1 = std::min(i0 + (1L << (z.k + 1)) - 1, n);
+			for (long i = i0; i < i1 && a[i].tStart <= hi; i++) {
+				if (a[i].tStop >= lo) {
+					f(a[i]);
+				}
+			}
+		} else if (!z.w) {
+			/* Visit the left child first, unless its subtree ends before lo */
+			long y = z.x - (1L << (z.k - 1));
+			stack[t++] = {z.x, z.k, true};
+			if (y >= n || max_stop[y] >= lo) {
+				stack[t++] = {y, z.k - 1, false};
+			}
+		} else if (z.x < n && a[z.x].tStart <= hi) {
+			if (a[z.x].tStop >= lo) {
+				f(a[z.x]);
+			}
+			stack[t++] = {z.x + (1L << (z.k - 1)), z.k - 1, false};
+		}
+	}
+}
+
+} // namespace interval_index
+
+#endif
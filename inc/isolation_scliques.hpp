@@ -11,4 +11,12 @@ NodeSetSet min_c_isolated_clique(SGraph &g, int c);
 
 NodeSetSet avg_c_isolated_clique(SGraph &g, int c);
 
+/*
+ * Seeded queries: the cliques of the searches above containing every node of seeds. Only the pivots within
+ * a few hops of the seeds are visited.
+ */
+NodeSetSet max_c_isolated_clique_seeded(SGraph &g, int c, const NodeSet &seeds);
+
+NodeSetSet min_c_isolated_clique_seeded(SGraph &g, int c, const NodeSet &seeds);
+
 #endif
\ No newline at end of file
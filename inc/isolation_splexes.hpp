@@ -5,7 +5,25 @@
 
 NodeSetSet min_bdd_d_set(SGraph &g, int k, int d, NodeSet &candidate);
 
-void foreach_kplex_pivot(int k, NodeSet &pivot_candidates, function<void(NodeSet &)> callback);
+BitsetSet min_bdd_d_set(const AdjMatrix &g, int k, int d, const Bitset &candidate);
+
+/* Vertices that may be in a pivot set of pivot_node, given its candidate set (see foreach_kplex_pivot) */
+NodeSet kplex_pivot_reach(SGraph &g, int k, int max_del, NodeId pivot_node, const NodeSet &candidate);
+
+/*
+ * Calls callback on the empty set and on every pivot set, i.e. subset of at most k - 1 pivot candidates, that
+ * may be part of a k-plex built from candidate with at most max_del deletions. Pivot sets containing a vertex
+ * without enough neighbours in candidate and in the pivot set are skipped, as are their supersets when no
+ * further vertex can make up for it.
+ */
+void foreach_kplex_pivot(SGraph &g, int k, int max_del, const NodeSet &candidate, NodeSet &pivot_candidates,
+			 function<void(NodeSet &)> callback);
+
+/*
+ * Nodes that may be the pivot of a plex containing every node of seeds, i.e. whose pivot reach may include
+ * them all; every node of the graph if seeds is empty.
+ */
+NodeSet kplex_seed_pivots(SGraph &g, int k, int c, const NodeSet &seeds);
 
 NodeSetSet min_c_isolated_kplex(SGraph &g, int c, int k);
 
@@ -13,8 +31,27 @@ NodeSetSet max_c_isolated_kplex(SGraph &g, int c, int k);
 
 NodeSetSet avg_c_isolated_kplex(SGraph &g, int c, int k);
 
+/*
+ * Seeded queries: the plexes of the searches above containing every node of seeds. Only the pivots of
+ * kplex_seed_pivots are visited, and the candidates are trimmed as in the full search, so the plexes returned
+ * are exactly those of the full search that contain the seeds.
+ */
+NodeSetSet min_c_isolated_kplex_seeded(SGraph &g, int c, int k, const NodeSet &seeds);
+
+NodeSetSet max_c_isolated_kplex_seeded(SGraph &g, int c, int k, const NodeSet &restriction, const NodeSet &seeds);
+
+NodeSetSet avg_c_isolated_kplex_seeded(SGraph &g, int c, int k, const NodeSet &restriction, const NodeSet &seeds);
+
 NodeSetSet max_c_isolated_kplex_restricted(SGraph &g, int c, int k, const NodeSet &restriction);
 
 NodeSetSet avg_c_isolated_kplex_restricted(SGraph &g, int c, int k, const NodeSet &restriction);
 
+/*
+ * Nodes of restriction that may belong to a max- (resp. avg-) c-isolated k-plex of at least k + 2 nodes within
+ * restriction. The restricted enumerators peel the other nodes before the pivot loop.
+ */
+NodeSet max_c_isolated_kplex_core(SGraph &g, int c, const NodeSet &restriction);
+
+NodeSet avg_c_isolated_kplex_core(SGraph &g, int c, int k, const NodeSet &restriction);
+
 #endif
\ No newline at end of file
@@ -3,8 +3,61 @@
 
 #include <Graph.hpp>
 
+#include <unordered_map>
+
 NodeSetIntervalSet c_isolated_temporal_kplex(TGraph &g, int k, int c, TemporalIsolationType isolation);
 
+/*
+ * Same as above, over the part of the lifetime within [t_from, t_to] only, as if the edges were clipped to it.
+ * Edges out of the window are never visited.
+ */
+NodeSetIntervalSet c_isolated_temporal_kplex(TGraph &g, int k, int c, TemporalIsolationType isolation,
+					     NodeTime t_from, NodeTime t_to);
+
+/*
+ * Seeded query: the pairs of the search above whose node set contains every node of seeds. Only the candidates
+ * containing the seeds are kept, found by seeded static searches (see isolation_splexes.hpp), and only the
+ * instants where every seed has an edge alive are initialized.
+ */
+NodeSetIntervalSet c_isolated_temporal_kplex(TGraph &g, int k, int c, TemporalIsolationType isolation,
+					     NodeTime t_from, NodeTime t_to, const NodeSet &seeds);
+
+/*
+ * Incremental c_isolated_temporal_kplex over a temporal graph growing by whole instants, in increasing order.
+ * The candidates of the intervals ending at each new instant are derived from those ending at the previous one,
+ * so only the last column of the table is kept.
+ *
+ * A (node set, interval) pair is reported once it is final: found pairs are k-plexes throughout their interval,
+ * so no interval containing it can be found once the set stops being a k-plex. The pairs reported over the
+ * whole graph are the ones c_isolated_temporal_kplex returns.
+ */
+class TemporalKplexStream {
+	int k, c;
+	TemporalIsolationType isolation;
+
+	/* First instant the intervals have been extended to */
+	NodeTime first;
+	bool started;
+
+	/* Candidates of the intervals ending at the last instant, by begin */
+	map<NodeTime, NodeSetSet> column;
+
+	/* Intervals of the node sets not reported yet, none of them contained in another one */
+	std::unordered_map<NodeSet, vector<Interval>, boost::hash<NodeSet>> pending;
+
+      public:
+	TemporalKplexStream(int k, int c, TemporalIsolationType isolation);
+
+	/*
+	 * Extends the intervals to the instant t following the last one, given every edge alive until t in g.
+	 * The pairs found final are inserted in found.
+	 */
+	void extend(TGraph &g, NodeTime t, NodeSetIntervalSet &found);
+
+	/* No instant follows: inserts every pair left in found */
+	void finish(NodeSetIntervalSet &found);
+};
+
 NodeSetSet alltime_max_isolated_subset(TGraph &g, const NodeSet &nodeset, int k, int c, NodeTime t_start, NodeTime t_stop, int delta);
 
 NodeSetSet max_usually_isolated_subset(TGraph &g, const NodeSet &nodeset, int k, int c, NodeTime t_start, NodeTime t_stop, int delta);
@@ -0,0 +1,65 @@
+#ifndef SCHEDULER_HPP_
+#define SCHEDULER_HPP_
+
+#include <algorithm>
+#include <omp.h>
+
+#include <conf.hpp>
+
+/*
+ * Process-wide scheduling of the parallel work. A single OpenMP team owns every thread: the outermost call
+ * opens it, and every nested level submits tasks to its pool, which OpenMP balances by work stealing. No
+ * parallel region is ever opened inside another one.
+ *
+ * Policy: a loop with enough iterations to keep every thread busy runs its iterations as final tasks, so that
+ * the levels below it (e.g. the pivots of a window, when looping over windows) run inline instead of splitting
+ * further. Smaller loops let the levels below spawn their own tasks.
+ *
+ * With parallelism disabled everything runs inline on the calling thread.
+ */
+namespace scheduler {
+
+/* Iterations per thread above which a loop is considered to saturate the team */
+#define SCHEDULER_SATURATION 4
+
+/* Tasks per thread a loop is split into at most, for load balancing */
+#define SCHEDULER_TASKS_PER_THREAD 16
+
+/* Runs f on a thread of the team, opening the team if needed; returns once f and all its tasks are done */
+template <typename F> void run(F f) {
+	if (!parallelism || omp_in_final()) {
+		f();
+	} else if (omp_in_parallel()) {
+#pragma omp taskgroup
+		f();
+	} else {
+#pragma omp parallel
+#pragma omp single
+		f();
+	}
+}
+
+/* Calls body(i) for every i in [0, n) as tasks of the team, and waits for them */
+template <typename F> void parallel_for(long n, F body) {
+	if (!parallelism || omp_in_final() || n <= 1) {
+		for (long i = 0; i < n; i++) {
+			body(i);
+		}
+		return;
+	}
+
+	run([&] {
+		long threads = omp_get_num_threads();
+		bool saturating = n >= SCHEDULER_SATURATION * threads;
+		long tasks = std::min(n, SCHEDULER_TASKS_PER_THREAD * threads);
+
+#pragma omp taskloop num_tasks(tasks) final(saturating)
+		for (long i = 0; i < n; i++) {
+			body(i);
+		}
+	});
+}
+
+} // namespace scheduler
+
+#endif
@@ -4,14 +4,145 @@
 #include "Graph.hpp"
 #include <fstream>
 #include <string>
+#include <unordered_map>
 
 using std::ifstream;
+using std::pair;
 using std::string;
+using std::vector;
 
+/* Read-only view of the contents of a file, memory-mapped when possible */
+class MappedFile {
+	const char *data;
+	size_t length;
+	void *mapping;
+	vector<char> buffer;
+	bool open;
+
+      public:
+	MappedFile(const string &path);
+
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	bool isOpen() const;
+
+	const char *begin() const;
+
+	const char *end() const;
+
+	size_t size() const;
+};
+
+/*
+ * Edge lists are text files with one record per line: "u v" for static graphs, "t u v" for temporal ones. Fields
+ * are integers separated by spaces, tabs or commas; lines not starting with a full record are skipped.
+ */
 SGraph load_sgraph(string path);
 
 TGraph load_tgraph(string path);
 
 TGraph load_tgraph(string path, bool squash, NodeTime sliding_window, NodeTime downsample);
 
+/*
+ * Maps the instants of a temporal graph loaded with bridged gaps back to the instants it would have had
+ * otherwise. Each segment is a run of compressed instants with a constant shift.
+ */
+class Timeline {
+	/* (first compressed instant, its original instant) of each segment, in increasing order */
+	vector<pair<NodeTime, NodeTime>> segments;
+
+      public:
+	void addSegment(NodeTime compressed, NodeTime original);
+
+	NodeTime original(NodeTime t) const;
+
+	Interval original(const Interval &interval) const;
+
+	/*
+	 * Compressed instant of the original instant t. Instants within a removed gap map to the first instant after
+	 * it if next is set, else to the last one before it.
+	 */
+	NodeTime compressed(NodeTime t, bool next) const;
+
+	const vector<pair<NodeTime, NodeTime>> &getSegments() const;
+};
+
+/*
+ * Same as above, but empty gaps of at most max_gap instants between two consecutive timestamps are removed,
+ * so that contacts on both sides are contiguous. The timeline maps the instants of the returned graph back.
+ */
+TGraph load_tgraph(string path, bool squash, NodeTime sliding_window, NodeTime downsample, NodeTime max_gap,
+		   Timeline &timeline);
+
+/*
+ * Temporal edge list read as a stream of contacts in non-decreasing time order, from a file or from the standard
+ * input ("-"), e.g. piped from tail -f. Contacts are preprocessed and aggregated into temporal edges as by
+ * load_tgraph. An instant is complete once no later contact may change the edges alive at it.
+ */
+class ContactStream {
+	int fd;
+	bool at_end;
+
+	/* Partial last line of the input read so far */
+	vector<char> partial;
+
+	bool squash;
+	NodeTime sliding_window, downsample, max_gap;
+
+	/* Last timestamp read, number of distinct timestamps, and the instant they are mapped to */
+	NodeTime last_timestamp, timestamps, instant;
+	NodeTime first_instant;
+
+	/* Last downsampled instant and its compressed instant, when bridging the gaps */
+	NodeTime prev, prev_compressed;
+
+	vector<TEdge> edges;
+	std::unordered_map<pair<NodeId, NodeId>, size_t, boost::hash<pair<NodeId, NodeId>>> last_edge;
+	Timeline timeline;
+
+	void add(NodeTime timestamp, NodeId nodeFrom, NodeId nodeTo);
+
+      public:
+	ContactStream(const string &path, bool squash, NodeTime sliding_window, NodeTime downsample, NodeTime max_gap);
+
+	~ContactStream();
+
+	ContactStream(const ContactStream &) = delete;
+
+	ContactStream &operator=(const ContactStream &) = delete;
+
+	/* Reads the contacts available, waiting for more if there are none; false once the input is over */
+	bool read();
+
+	/* Whether no contact has been read */
+	bool empty() const;
+
+	NodeTime first() const;
+
+	/* Last complete instant; every instant is complete once the input is over */
+	NodeTime complete() const;
+
+	/* Temporal graph of the contacts read so far */
+	TGraph graph() const;
+
+	const Timeline &getTimeline() const;
+};
+
+/*
+ * Binary graph files (see GraphFile.hpp), loaded by the functions above in place of text edge lists. Temporal
+ * graphs are saved after preprocessing, along with their timeline.
+ */
+bool save_sgraph(SGraph &g, string path);
+
+bool save_tgraph(TGraph &g, string path, bool squash, NodeTime sliding_window, NodeTime downsample,
+		 NodeTime max_gap, const Timeline &timeline);
+
+/* False, with an error logged, if path is a graph file of another kind or preprocessing than the requested one */
+bool graph_file_compatible(string path, bool temporal, bool squash, NodeTime sliding_window, NodeTime downsample,
+			   NodeTime max_gap);
+
 #endif
\ No newline at end of file
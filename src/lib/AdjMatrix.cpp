@@ -0,0 +1,155 @@
+#include <Graph.hpp>
+
+#include <algorithm>
+
+using std::binary_search;
+using std::lower_bound;
+
+AdjMatrix::AdjMatrix() {
+}
+
+AdjMatrix::AdjMatrix(SGraph &g, const NodeSet &restriction) : nodes(restriction.begin(), restriction.end()) {
+	int n = (int)(this->nodes.size());
+	this->rows.assign(n, Bitset(n));
+	this->degrees.assign(n, 0);
+
+	/* Dense graph indices of the restriction, sorted since dense indices follow the NodeId order */
+	vector<int> dense;
+	vector<int> local;
+	dense.reserve(n);
+	local.reserve(n);
+	for (int i = 0; i < n; i++) {
+		int d = g.index(this->nodes[i]);
+		if (d >= 0) {
+			this->degrees[i] = g.row(d).size();
+			dense.push_back(d);
+			local.push_back(i);
+		}
+	}
+
+	/* Intersect each row with the restriction, probing the shorter of the two sorted sequences */
+	for (size_t a = 0; a < dense.size(); a++) {
+		SGraph::Row r = g.row(dense[a]);
+		const int *row_begin = r.begin(), *row_end = r.end();
+		Bitset &row = this->rows[local[a]];
+
+		if (row_end - row_begin <= (long)dense.size()) {
+			for (const int *p = row_begin; p < row_end; p++) {
+				auto it = lower_bound(dense.begin(), dense.end(), *p);
+				if (it != dense.end() && *it == *p) {
+					row.set(local[it - dense.begin()]);
+				}
+			}
+		} else {
+			for (size_t b = 0; b < dense.size(); b++) {
+				if (binary_search(row_begin, row_end, dense[b])) {
+					row.set(local[b]);
+				}
+			}
+		}
+	}
+}
+
+int AdjMatrix::size() const {
+	return (int)(this->nodes.size());
+}
+
+NodeId AdjMatrix::nodeId(int i) const {
+	return this->nodes[i];
+}
+
+int AdjMatrix::index(NodeId node) const {
+	auto it = lower_bound(this->nodes.begin(), this->nodes.end(), node);
+	return (it != this->nodes.end() && *it == node) ? (int)(it - this->nodes.begin()) : -1;
+}
+
+bool AdjMatrix::hasEdge(int i, int j) const {
+	return this->rows[i].test(j);
+}
+
+const Bitset &AdjMatrix::row(int i) const {
+	return this->rows[i];
+}
+
+int AdjMatrix::degree(int i) const {
+	return this->rows[i].count();
+}
+
+int AdjMatrix::globalDegree(int i) const {
+	return this->degrees[i];
+}
+
+int AdjMatrix::degree(int i, const Bitset &restriction) const {
+	return this->rows[i].count_and(restriction);
+}
+
+int AdjMatrix::outdegree(int i, const Bitset &in) const {
+	return this->degrees[i] - this->rows[i].count_and(in);
+}
+
+int AdjMatrix::outdegree_sum(const Bitset &restriction) const {
+	int sum = 0;
+	restriction.forall([&](int i) { sum += this->outdegree(i, restriction); });
+
+	return sum;
+}
+
+bool AdjMatrix::isKplex(const Bitset &plex, int k) const {
+	int size = plex.count();
+	bool ret = true;
+	plex.forall([&](int i) {
+		if (ret && this->degree(i, plex) < size - k) {
+			ret = false;
+		}
+	});
+
+	return ret;
+}
+
+Bitset AdjMatrix::toBitset(const NodeSet &nodeset) const {
+	Bitset ret(this->size());
+	for (NodeId u : nodeset) {
+		int i = this->index(u);
+		if (i >= 0) {
+			ret.set(i);
+		}
+	}
+
+	return ret;
+}
+
+NodeSet AdjMatrix::toNodeSet(const Bitset &bits) const {
+	NodeSet ret;
+	bits.forall([&](int i) { ret.insert(ret.end(), this->nodes[i]); });
+
+	return ret;
+}
+
+AdjMatrix AdjMatrix::complement() const {
+	AdjMatrix ret;
+	ret.nodes = this->nodes;
+	ret.rows = this->rows;
+
+	ret.degrees.resize(ret.rows.size());
+	for (int i = 0; i < (int)(ret.rows.size()); i++) {
+		ret.rows[i].flip();
+		ret.rows[i].reset(i);
+		ret.degrees[i] = ret.rows[i].count();
+	}
+
+	return ret;
+}
+
+SGraph AdjMatrix::toGraph() const {
+	vector<SEdge> edges;
+
+	for (int i = 0; i < (int)(this->rows.size()); i++) {
+		this->rows[i].forall([&](int j) {
+			if (i <= j) {
+				edges.push_back(SEdge(this->nodes[i], this->nodes[j]));
+			}
+		});
+	}
+
+	return SGraph(this->nodes, edges);
+}
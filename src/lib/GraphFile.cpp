@@ -0,0 +1,142 @@
+#include <GraphFile.hpp>
+
+#include <spdlog/spdlog.h>
+
+GraphFileWriter::GraphFileWriter(const string &path, const GraphFileHeader &header)
+    : out(path, std::ios::binary | std::ios::trunc) {
+	this->raw(&header, sizeof(header));
+}
+
+void GraphFileWriter::raw(const void *data, size_t size) {
+	this->out.write((const char *)(data), (std::streamsize)(size));
+}
+
+bool GraphFileWriter::good() const {
+	return this->out.good();
+}
+
+GraphFileReader::GraphFileReader(const string &path) : file(path), cursor(file.begin()), valid(false) {
+	if (this->file.size() >= sizeof(this->file_header)) {
+		memcpy(&this->file_header, this->file.begin(), sizeof(this->file_header));
+		this->cursor += sizeof(this->file_header);
+		this->valid = memcmp(this->file_header.magic, GRAPH_FILE_MAGIC, sizeof(this->file_header.magic)) == 0 &&
+			      this->file_header.version == GRAPH_FILE_VERSION;
+	}
+}
+
+bool GraphFileReader::good() const {
+	return this->valid;
+}
+
+bool read_graph_file_header(const string &path, GraphFileHeader &header) {
+	std::ifstream in(path, std::ios::binary);
+	if (!in.read((char *)(&header), sizeof(header))) {
+		return false;
+	}
+
+	return memcmp(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic)) == 0;
+}
+
+GraphFileHeader graph_file_header(GraphFileKind kind, bool squash, NodeTime sliding_window, NodeTime downsample,
+				  NodeTime max_gap) {
+	GraphFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic));
+	header.version = GRAPH_FILE_VERSION;
+	header.kind = kind;
+
+	if (kind == GRAPH_FILE_TEMPORAL) {
+		header.squash = squash;
+		header.sliding_window = sliding_window;
+		header.downsample = downsample;
+		header.max_gap = squash ? 0 : max_gap;
+	}
+
+	return header;
+}
+
+bool graph_file_compatible(string path, bool temporal, bool squash, NodeTime sliding_window, NodeTime downsample,
+			   NodeTime max_gap) {
+	GraphFileHeader header;
+	if (!read_graph_file_header(path, header)) {
+		return true;
+	}
+
+	if (header.version != GRAPH_FILE_VERSION) {
+		spdlog::error("Graph file {} has version {}, version {} is supported", path, header.version,
+			      GRAPH_FILE_VERSION);
+		return false;
+	}
+
+	GraphFileHeader requested = graph_file_header(temporal ? GRAPH_FILE_TEMPORAL : GRAPH_FILE_STATIC, squash,
+						      sliding_window, downsample, max_gap);
+	if (header.kind != requested.kind) {
+		spdlog::error("Graph file {} holds a {} graph", path,
+			      header.kind == GRAPH_FILE_TEMPORAL ? "temporal" : "static");
+		return false;
+	}
+
+	if (memcmp(&header, &requested, sizeof(header)) != 0) {
+		spdlog::error("Graph file {} was converted with{} -w {} -D {} -g {}, convert it again for these parameters",
+			      path, header.squash ? " -s" : "", header.sliding_window, header.downsample, header.max_gap);
+		return false;
+	}
+
+	return true;
+}
+
+SGraph load_sgraph_file(const string &path) {
+	if (!graph_file_compatible(path, false, false, 0, 1, 0)) {
+		return SGraph();
+	}
+
+	GraphFileReader in(path);
+	SGraph g(in);
+	if (!in.good()) {
+		spdlog::error("Graph file {} is truncated", path);
+	}
+
+	return g;
+}
+
+TGraph load_tgraph_file(const string &path, bool squash, NodeTime sliding_window, NodeTime downsample,
+			NodeTime max_gap, Timeline &timeline) {
+	if (!graph_file_compatible(path, true, squash, sliding_window, downsample, max_gap)) {
+		return TGraph();
+	}
+
+	GraphFileReader in(path);
+	TGraph g(in);
+	/* Segments are stored flattened, as (compressed, original) pairs */
+	vector<NodeTime> segments = in.read<NodeTime>();
+	for (size_t i = 0; i + 1 < segments.size(); i += 2) {
+		timeline.addSegment(segments[i], segments[i + 1]);
+	}
+	if (!in.good()) {
+		spdlog::error("Graph file {} is truncated", path);
+	}
+
+	return g;
+}
+
+bool save_sgraph(SGraph &g, string path) {
+	GraphFileWriter out(path, graph_file_header(GRAPH_FILE_STATIC, false, 0, 1, 0));
+	g.write(out);
+
+	return out.good();
+}
+
+bool save_tgraph(TGraph &g, string path, bool squash, NodeTime sliding_window, NodeTime downsample,
+		 NodeTime max_gap, const Timeline &timeline) {
+	GraphFileWriter out(path, graph_file_header(GRAPH_FILE_TEMPORAL, squash, sliding_window, downsample, max_gap));
+	g.write(out);
+
+	vector<NodeTime> segments;
+	for (const pair<NodeTime, NodeTime> &segment : timeline.getSegments()) {
+		segments.push_back(segment.first);
+		segments.push_back(segment.second);
+	}
+	out.write(segments);
+
+	return out.good();
+}
@@ -1,12 +1,18 @@
 #include <Graph.hpp>
+#include <GraphFile.hpp>
 
 #include <algorithm>
+#include <limits>
 #include <stack>
+#include <unordered_map>
 
 #include <spdlog/spdlog.h>
 
-using std::find;
+#include <scheduler.hpp>
+
+using std::sort;
 using std::stack;
+using std::unique;
 
 std::size_t hash_value(SEdge const &e) {
 	size_t seed = 0;
@@ -16,67 +22,216 @@ std::size_t hash_value(SEdge const &e) {
 	return seed;
 }
 
+NodeIndex::NodeIndex() : base(0) {
+}
+
+NodeIndex::NodeIndex(vector<NodeId> nodes) : base(0) {
+	sort(nodes.begin(), nodes.end());
+	nodes.erase(unique(nodes.begin(), nodes.end()), nodes.end());
+	this->ids = std::move(nodes);
+
+	long n = (long)(this->ids.size());
+	if (n > 0 && (long)this->ids.back() - (long)this->ids.front() < 4 * n + 1024) {
+		this->base = this->ids.front();
+		this->table.assign(this->ids.back() - this->base + 1, -1);
+		for (int i = 0; i < (int)n; i++) {
+			this->table[this->ids[i] - this->base] = i;
+		}
+	}
+}
+
 SGraph::SGraph() {
+	/* Every empty graph shares the same storage */
+	static const std::shared_ptr<const CSR> empty = std::make_shared<const CSR>(CSR{NodeIndex(), {0}, {}, {}, {0}, {}});
+	this->csr = empty;
 }
 
-SGraph::SGraph(vector<SEdge> &edgeList) {
-	for (const SEdge &e : edgeList) {
-		(this->adj_list[e.nodeFrom]).insert(e);
-		(this->adj_list[e.nodeTo]).insert(SEdge(e.nodeTo, e.nodeFrom));
+SGraph::SGraph(const vector<SEdge> &edgeList) {
+	vector<NodeId> nodes;
+	this->build(nodes, edgeList);
+}
+
+SGraph::SGraph(const vector<NodeId> &nodes, const vector<SEdge> &edgeList) {
+	vector<NodeId> nodes_cpy = nodes;
+	this->build(nodes_cpy, edgeList);
+}
+
+SGraph::SGraph(const SGraph &base, const map<int, vector<int>> &rows) : csr(base.csr) {
+	/* Merge the new rows with the rows already replaced in base, both sorted by dense index */
+	size_t o = 0;
+	auto it = rows.begin();
+	const int none = std::numeric_limits<int>::max();
+
+	this->overlay_offsets.push_back(0);
+	while (o < base.overlay_nodes.size() || it != rows.end()) {
+		int b = o < base.overlay_nodes.size() ? base.overlay_nodes[o] : none;
+		int r = it != rows.end() ? it->first : none;
+		if (r <= b) {
+			this->overlay_nodes.push_back(r);
+			this->overlay_adj.insert(this->overlay_adj.end(), it->second.begin(), it->second.end());
+			it++;
+			if (r == b) {
+				o++;
+			}
+		} else {
+			this->overlay_nodes.push_back(b);
+			this->overlay_adj.insert(this->overlay_adj.end(), base.rowBegin(b), base.rowEnd(b));
+			o++;
+		}
+		this->overlay_offsets.push_back((int)(this->overlay_adj.size()));
+	}
+}
+
+SGraph::SGraph(GraphFileReader &in) {
+	auto csr = std::make_shared<CSR>();
+	csr->nodes = NodeIndex(in.read<NodeId>());
+	csr->offsets = in.read<int>();
+	csr->adj = in.read<int>();
+	csr->component = in.read<int>();
+	csr->component_offsets = in.read<int>();
+	csr->component_nodes = in.read<int>();
+
+	if (in.good()) {
+		this->csr = csr;
+	} else {
+		this->csr = SGraph().csr;
 	}
 }
 
-SGraph::SGraph(const SGraph &g2) {
-	this->adj_list = g2.adj_list;
+void SGraph::write(GraphFileWriter &out) const {
+	out.write(this->csr->nodes.getIds());
+	out.write(this->csr->offsets);
+	out.write(this->csr->adj);
+	out.write(this->csr->component);
+	out.write(this->csr->component_offsets);
+	out.write(this->csr->component_nodes);
 }
 
-SGraph::SGraph(unordered_set<SEdge, boost::hash<SEdge>> &edgeList) {
+void SGraph::build(vector<NodeId> &nodes, const vector<SEdge> &edgeList) {
+	/* Collect every node id and assign dense indices in increasing id order */
 	for (const SEdge &e : edgeList) {
-		(this->adj_list[e.nodeFrom]).insert(e);
-		if (edgeList.find(SEdge(e.nodeTo, e.nodeFrom)) == edgeList.end()) {
-			(this->adj_list[e.nodeTo]).insert(SEdge(e.nodeTo, e.nodeFrom));
+		nodes.push_back(e.nodeFrom);
+		nodes.push_back(e.nodeTo);
+	}
+	auto csr = std::make_shared<CSR>();
+	csr->nodes = NodeIndex(std::move(nodes));
+	int n = csr->nodes.size();
+
+	/* Count, fill, then sort and deduplicate every row */
+	vector<int> fill(n + 1, 0);
+	for (const SEdge &e : edgeList) {
+		fill[csr->nodes.index(e.nodeFrom) + 1]++;
+		if (e.nodeFrom != e.nodeTo) {
+			fill[csr->nodes.index(e.nodeTo) + 1]++;
+		}
+	}
+	for (int i = 0; i < n; i++) {
+		fill[i + 1] += fill[i];
+	}
+
+	vector<int> raw(fill[n]);
+	vector<int> pos(fill.begin(), fill.end() - 1);
+	for (const SEdge &e : edgeList) {
+		int u = csr->nodes.index(e.nodeFrom), v = csr->nodes.index(e.nodeTo);
+		raw[pos[u]++] = v;
+		if (u != v) {
+			raw[pos[v]++] = u;
 		}
 	}
-}
 
-void SGraph::addNode(NodeId n) {
-	if (this->adj_list.find(n) == this->adj_list.end()) {
-		this->adj_list[n] = unordered_set<SEdge, boost::hash<SEdge>>();
+	csr->offsets.assign(n + 1, 0);
+	csr->adj.reserve(raw.size());
+	for (int i = 0; i < n; i++) {
+		auto row_begin = raw.begin() + fill[i], row_end = raw.begin() + fill[i + 1];
+		sort(row_begin, row_end);
+		row_end = unique(row_begin, row_end);
+		csr->adj.insert(csr->adj.end(), row_begin, row_end);
+		csr->offsets[i + 1] = (int)(csr->adj.size());
+	}
+	this->csr = csr;
+
+	/* One-shot component labelling, then group the dense indices by label */
+	vector<int> starts(n);
+	for (int i = 0; i < n; i++) {
+		starts[i] = i;
+	}
+	int count = this->labelComponents(starts, csr->component);
+
+	csr->component_offsets.assign(count + 1, 0);
+	for (int i = 0; i < n; i++) {
+		csr->component_offsets[csr->component[i] + 1]++;
+	}
+	for (int l = 0; l < count; l++) {
+		csr->component_offsets[l + 1] += csr->component_offsets[l];
+	}
+	csr->component_nodes.resize(n);
+	vector<int> cpos(csr->component_offsets.begin(), csr->component_offsets.end() - 1);
+	for (int i = 0; i < n; i++) {
+		csr->component_nodes[cpos[csr->component[i]]++] = i;
 	}
 }
 
-void SGraph::addEdge(SEdge e) {
-	(this->adj_list[e.nodeFrom]).insert(e);
-	(this->adj_list[e.nodeTo]).insert(SEdge(e.nodeTo, e.nodeFrom));
+int SGraph::labelComponents(const vector<int> &starts, vector<int> &label) const {
+	label.assign(this->csr->nodes.size(), -1);
+	int count = 0;
+	stack<int> dfs;
+
+	for (int start : starts) {
+		if (label[start] >= 0) {
+			continue;
+		}
+
+		label[start] = count;
+		dfs.push(start);
+		while (!dfs.empty()) {
+			int w = dfs.top();
+			dfs.pop();
+
+			for (int v : this->row(w)) {
+				if (label[v] < 0) {
+					label[v] = count;
+					dfs.push(v);
+				}
+			}
+		}
+		count++;
+	}
+
+	return count;
 }
 
 int SGraph::getNodesCount() {
-	return (int)(this->adj_list.size());
+	return this->csr->nodes.size();
 }
 
 int SGraph::getEdgesCount() {
-	int cnt = 0;
-	for (const auto &l : this->adj_list) {
-		cnt += (int)(l.second.size());
+	long entries = (long)(this->csr->adj.size());
+	for (size_t o = 0; o < this->overlay_nodes.size(); o++) {
+		int u = this->overlay_nodes[o];
+		entries += (this->overlay_offsets[o + 1] - this->overlay_offsets[o]) -
+			   (this->csr->offsets[u + 1] - this->csr->offsets[u]);
 	}
 
-	return cnt / 2;
+	return (int)(entries / 2);
 }
 
 int SGraph::degree(NodeId node) {
-	return (int)((this->adj_list[node]).size());
+	int u = this->index(node);
+	return u < 0 ? 0 : this->row(u).size();
 }
 
 int SGraph::degree(NodeId node, const NodeSet &restriction) {
 	int deg = 0;
+	int u = this->index(node);
+	if (u < 0) {
+		return 0;
+	}
 
-	this->forallNeighbours(node,
-			       [&](NodeId n) {
-				       if (restriction.find(n) != restriction.end()) {
-					       deg++;
-				       }
-			       },
-			       false);
+	for (int v : this->row(u)) {
+		if (restriction.find(this->nodeId(v)) != restriction.end()) {
+			deg++;
+		}
+	}
 
 	return deg;
 }
@@ -95,31 +250,40 @@ int SGraph::mindegree(const NodeSet &restriction) {
 
 int SGraph::outdegree(NodeId node, const NodeSet &in) {
 	int deg = 0;
+	int u = this->index(node);
+	if (u < 0) {
+		return 0;
+	}
 
-	this->forallNeighbours(node,
-			       [&](NodeId n) {
-				       if (in.find(n) == in.end()) {
-					       deg++;
-				       }
-			       },
-			       false);
+	for (int v : this->row(u)) {
+		if (in.find(this->nodeId(v)) == in.end()) {
+			deg++;
+		}
+	}
 
 	return deg;
 }
 
 NodeSet SGraph::neighbourhood(NodeId node) {
 	NodeSet v;
-	for (SEdge e : this->adj_list[node]) {
-		v.insert(e.nodeTo);
+	int u = this->index(node);
+	if (u >= 0) {
+		for (int w : this->row(u)) {
+			v.insert(v.end(), this->nodeId(w));
+		}
 	}
 	return v;
 }
 
 NodeSet SGraph::neighbourhood(NodeId node, const NodeSet &restriction) {
 	NodeSet v;
-	for (SEdge e : this->adj_list[node]) {
-		if (restriction.find(e.nodeTo) != restriction.end()) {
-			v.insert(e.nodeTo);
+	int u = this->index(node);
+	if (u >= 0) {
+		for (int w : this->row(u)) {
+			NodeId n = this->nodeId(w);
+			if (restriction.find(n) != restriction.end()) {
+				v.insert(v.end(), n);
+			}
 		}
 	}
 	return v;
@@ -154,109 +318,243 @@ NodeSet SGraph::neighbourhoodSmallerDeg(NodeId node) {
 }
 
 SGraph SGraph::buildComplement(const NodeSet &restriction) {
-	SGraph ret;
+	return AdjMatrix(*this, restriction).complement().toGraph();
+}
 
-	for (NodeId u : restriction) {
-		ret.addNode(u);
-		for (NodeId v : restriction) {
-			if (u != v && !this->hasEdge(u, v)) {
-				ret.addEdge(SEdge(u, v));
+void SGraph::forallNodes(function<void(NodeId)> callback, bool parallel) {
+	this->forallNodes<const function<void(NodeId)> &>(callback, parallel);
+}
+
+void SGraph::forallNeighbours(NodeId node, function<void(NodeId)> callback, bool parallel) {
+	this->forallNeighbours<const function<void(NodeId)> &>(node, callback, parallel);
+}
+
+NodeSet SGraph::getNodes() {
+	return NodeSet(this->csr->nodes.getIds().begin(), this->csr->nodes.getIds().end());
+}
+
+bool SGraph::hasEdge(NodeId u, NodeId v) {
+	int iu = this->index(u), iv = this->index(v);
+	if (iu < 0 || iv < 0) {
+		return false;
+	}
+
+	/* Probe the shorter row: short rows are scanned, long ones binary searched */
+	Row ru = this->row(iu), rv = this->row(iv);
+	if (ru.size() > rv.size()) {
+		std::swap(ru, rv);
+		std::swap(iu, iv);
+	}
+
+	if (ru.size() <= 16) {
+		return std::find(ru.begin(), ru.end(), iv) != ru.end();
+	}
+
+	return std::binary_search(ru.begin(), ru.end(), iv);
+}
+
+bool SGraph::isConnected(const NodeSet &subset) {
+	if (subset.empty()) {
+		return true;
+	}
+
+	vector<char> visited(this->csr->nodes.size(), 0);
+	stack<int> dfs;
+	size_t visited_cnt = 1;
+
+	int first = this->index(*subset.begin());
+	if (first < 0) {
+		return subset.size() == 1;
+	}
+	dfs.push(first);
+	visited[first] = 1;
+
+	while (!dfs.empty()) {
+		int u = dfs.top();
+		dfs.pop();
+
+		for (int v : this->row(u)) {
+			if (!visited[v] && subset.find(this->nodeId(v)) != subset.end()) {
+				visited[v] = 1;
+				visited_cnt++;
+				dfs.push(v);
 			}
 		}
 	}
 
-	return ret;
+	return visited_cnt == subset.size();
 }
 
-void SGraph::forallNodes(function<void(NodeId)> callback, bool parallel) {
-#pragma omp parallel if (parallel)
-	{
-#pragma omp single
-		{
-			for (const auto &entry : this->adj_list) {
-#pragma omp task if (parallel)
-				callback(entry.first);
+NodeSet SGraph::peel(const NodeSet &restriction, function<int(int)> required) {
+	/* Local indexing over the restriction: dense indices are sorted since they follow the NodeId order */
+	vector<int> dense;
+	vector<NodeId> ids;
+	for (NodeId u : restriction) {
+		int idx = this->index(u);
+		if (idx >= 0) {
+			dense.push_back(idx);
+			ids.push_back(u);
+		}
+	}
+	int n = (int)(dense.size());
+
+	/* Neighbours left in the restriction, and the bound of every node */
+	vector<int> left(n, 0), bound(n);
+	vector<vector<int>> local(n);
+	for (int a = 0; a < n; a++) {
+		Row r = this->row(dense[a]);
+		bound[a] = required(r.size());
+
+		for (int v : r) {
+			auto it = std::lower_bound(dense.begin(), dense.end(), v);
+			if (it != dense.end() && *it == v) {
+				local[a].push_back((int)(it - dense.begin()));
 			}
 		}
+		left[a] = (int)(local[a].size());
 	}
-}
 
-void SGraph::forallNeighbours(NodeId node, function<void(NodeId)> callback, bool parallel) {
-#pragma omp parallel if (parallel)
-	{
-#pragma omp single
-		{
-			for (SEdge n : this->adj_list[node]) {
-#pragma omp task if (parallel)
-				callback(n.nodeTo);
+	vector<char> peeled(n, 0);
+	stack<int> queue;
+	for (int a = 0; a < n; a++) {
+		if (left[a] < bound[a]) {
+			peeled[a] = 1;
+			queue.push(a);
+		}
+	}
+
+	while (!queue.empty()) {
+		int a = queue.top();
+		queue.pop();
+
+		for (int b : local[a]) {
+			if (!peeled[b] && --left[b] < bound[b]) {
+				peeled[b] = 1;
+				queue.push(b);
 			}
 		}
 	}
-}
 
-NodeSet SGraph::getNodes() {
 	NodeSet ret;
-	for (const auto &entry : this->adj_list) {
-		ret.insert(entry.first);
+	for (int a = 0; a < n; a++) {
+		if (!peeled[a]) {
+			ret.insert(ret.end(), ids[a]);
+		}
 	}
 
 	return ret;
 }
 
-bool SGraph::hasEdge(NodeId u, NodeId v) {
-	return find(this->adj_list[u].begin(), this->adj_list[u].end(), SEdge(u, v)) != this->adj_list[u].end();
+NodeSet SGraph::getReachableNodes(NodeId u) {
+	int start = this->index(u);
+	if (start < 0) {
+		return NodeSet({u});
+	}
+
+	NodeSet res;
+	if (this->overlay_nodes.empty()) {
+		const CSR &csr = *this->csr;
+		int l = csr.component[start];
+		for (int o = csr.component_offsets[l]; o < csr.component_offsets[l + 1]; o++) {
+			res.insert(res.end(), this->nodeId(csr.component_nodes[o]));
+		}
+		return res;
+	}
+
+	vector<int> label;
+	this->labelComponents(vector<int>({start}), label);
+	for (int i = 0; i < this->csr->nodes.size(); i++) {
+		if (label[i] >= 0) {
+			res.insert(res.end(), this->nodeId(i));
+		}
+	}
+
+	return res;
 }
 
-bool SGraph::isConnected(const NodeSet &subset) {
-	if (subset.empty()) {
-		return true;
+NodeSet SGraph::ball(const NodeSet &centers, int radius) {
+	/* Breadth-first search by dense index: only the nodes reached are visited */
+	NodeSet res;
+	unordered_set<int> seen;
+	vector<int> frontier;
+	for (NodeId u : centers) {
+		res.insert(u);
+		int idx = this->index(u);
+		if (idx >= 0 && seen.insert(idx).second) {
+			frontier.push_back(idx);
+		}
 	}
 
-	set<NodeId> visited;
-	stack<NodeId> dfs;
+	for (int d = 0; d < radius && !frontier.empty(); d++) {
+		vector<int> next;
+		for (int w : frontier) {
+			for (int v : this->row(w)) {
+				if (seen.insert(v).second) {
+					next.push_back(v);
+				}
+			}
+		}
+		frontier.swap(next);
+	}
 
-	dfs.push(*subset.begin());
-	visited.insert(*subset.begin());
+	for (int v : seen) {
+		res.insert(this->nodeId(v));
+	}
 
-	while (!dfs.empty()) {
-		NodeId u = dfs.top();
-		dfs.pop();
+	return res;
+}
+
+NodeSet SGraph::commonBall(const NodeSet &centers, int radius) {
+	if (centers.empty()) {
+		return this->getNodes();
+	}
 
-		this->forallNeighbours(u,
-				       [&](NodeId v) {
-					       if (subset.find(v) != subset.end() && visited.find(v) == subset.end()) {
-						       visited.insert(v);
-						       dfs.push(v);
-					       }
-				       },
-				       false);
+	NodeSet res = this->ball(NodeSet({*centers.begin()}), radius);
+	for (auto it = std::next(centers.begin()); it != centers.end() && !res.empty(); it++) {
+		NodeSet reach = this->ball(NodeSet({*it}), radius), common;
+		std::set_intersection(res.begin(), res.end(), reach.begin(), reach.end(),
+				      std::inserter(common, common.begin()));
+		res.swap(common);
 	}
 
-	return visited.size() == subset.size();
+	return res;
 }
 
-NodeSet SGraph::getReachableNodes(NodeId u) {
-	NodeSet res;
+vector<NodeSet> SGraph::groupByComponent(const NodeSet &nodes) {
+	vector<NodeSet> ret;
 
-	stack<NodeId> dfs;
-	dfs.push(u);
-	res.insert(u);
+	vector<int> starts;
+	for (NodeId u : nodes) {
+		int idx = this->index(u);
+		if (idx >= 0) {
+			starts.push_back(idx);
+		}
+	}
 
-	while (!dfs.empty()) {
-		NodeId u = dfs.top();
-		dfs.pop();
+	vector<int> computed;
+	if (!this->overlay_nodes.empty()) {
+		this->labelComponents(starts, computed);
+	}
+	const vector<int> &label = this->overlay_nodes.empty() ? this->csr->component : computed;
+
+	/* Nodes are visited in increasing order, so groups are created by smallest node */
+	std::unordered_map<int, int> group;
+	for (NodeId u : nodes) {
+		int idx = this->index(u);
+		if (idx < 0) {
+			ret.push_back(NodeSet({u}));
+			continue;
+		}
 
-		this->forallNeighbours(u,
-				       [&](NodeId v) {
-					       if (res.find(v) == res.end()) {
-						       res.insert(v);
-						       dfs.push(v);
-					       }
-				       },
-				       false);
+		auto it = group.find(label[idx]);
+		if (it == group.end()) {
+			it = group.emplace(label[idx], (int)(ret.size())).first;
+			ret.emplace_back();
+		}
+		ret[it->second].insert(ret[it->second].end(), u);
 	}
 
-	return res;
+	return ret;
 }
 
 bool SGraph::isKplex(const NodeSet &plex, int k) {
@@ -278,6 +576,66 @@ int SGraph::outdegree_sum(const NodeSet &restriction) {
 	return sum;
 }
 
+NodeSetSet maximal_sets(const NodeSetSet &sets, bool parallel) {
+	vector<const NodeSet *> all;
+	all.reserve(sets.size());
+	for (const NodeSet &s : sets) {
+		all.push_back(&s);
+	}
+
+	/* Inverted index: sets containing each node */
+	std::unordered_map<NodeId, vector<int>> containing;
+	for (int i = 0; i < (int)(all.size()); i++) {
+		for (NodeId u : *all[i]) {
+			containing[u].push_back(i);
+		}
+	}
+
+	vector<char> maximal(all.size(), 1);
+	auto screen = [&](long i) {
+		const NodeSet &s = *all[i];
+		if (s.empty()) {
+			/* Contained in any other set */
+			maximal[i] = all.size() == 1;
+			return;
+		}
+
+		/* A strict superset of s contains its rarest node */
+		const vector<int> *rarest = nullptr;
+		for (NodeId u : s) {
+			const vector<int> &list = containing.find(u)->second;
+			if (rarest == nullptr || list.size() < rarest->size()) {
+				rarest = &list;
+			}
+		}
+
+		for (int j : *rarest) {
+			const NodeSet &t = *all[j];
+			if (t.size() > s.size() && std::includes(t.begin(), t.end(), s.begin(), s.end())) {
+				maximal[i] = 0;
+				break;
+			}
+		}
+	};
+
+	if (parallel) {
+		scheduler::parallel_for((long)(all.size()), screen);
+	} else {
+		for (long i = 0; i < (long)(all.size()); i++) {
+			screen(i);
+		}
+	}
+
+	NodeSetSet ret;
+	for (int i = 0; i < (int)(all.size()); i++) {
+		if (maximal[i]) {
+			ret.insert(*all[i]);
+		}
+	}
+
+	return ret;
+}
+
 string nodeset_to_string(const NodeSet &nodeset) {
 	std::stringstream ss;
 	ss << "Set size: " << nodeset.size() << "; elems: ";
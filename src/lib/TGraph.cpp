@@ -1,12 +1,14 @@
 #include <Graph.hpp>
+#include <GraphFile.hpp>
+#include <IntervalIndex.hpp>
 
 #include <algorithm>
-#include <stack>
 
 #include <spdlog/spdlog.h>
 
 using std::max;
 using std::min;
+using std::sort;
 
 std::size_t hash_value(TEdge const &e) {
 	size_t seed = 0;
@@ -27,54 +29,119 @@ TGraph::TGraph(vector<TEdge> &edgeList) {
 	this->lifetime_begin = NODETIME_MAX;
 	this->lifetime_end = NODETIME_MIN;
 
-	for (TEdge &e : edgeList) {
-		(this->adj_list[e.nodeFrom]).insert(e);
-		(this->adj_list[e.nodeTo]).insert(TEdge(e.nodeTo, e.nodeFrom, e.tStart, e.tStop));
+	vector<NodeId> ids;
+	for (const TEdge &e : edgeList) {
+		ids.push_back(e.nodeFrom);
+		ids.push_back(e.nodeTo);
 
 		this->lifetime_begin = min(this->lifetime_begin, e.tStart);
 		this->lifetime_end = max(this->lifetime_end, e.tStop);
 	}
-}
+	this->nodes = NodeIndex(std::move(ids));
+	int n = this->nodes.size();
+
+	/* Bucket both directions of every edge by source node */
+	vector<int> pos(n + 1, 0);
+	for (const TEdge &e : edgeList) {
+		pos[this->nodes.index(e.nodeFrom) + 1]++;
+		if (e.nodeFrom != e.nodeTo) {
+			pos[this->nodes.index(e.nodeTo) + 1]++;
+		}
+	}
+	for (int i = 0; i < n; i++) {
+		pos[i + 1] += pos[i];
+	}
+
+	vector<TEdge> raw(pos[n]);
+	vector<int> fill(pos.begin(), pos.end() - 1);
+	for (const TEdge &e : edgeList) {
+		raw[fill[this->nodes.index(e.nodeFrom)]++] = e;
+		if (e.nodeFrom != e.nodeTo) {
+			raw[fill[this->nodes.index(e.nodeTo)]++] = TEdge(e.nodeTo, e.nodeFrom, e.tStart, e.tStop);
+		}
+	}
+
+	/* Sort each slice by start time, drop duplicates and build its interval tree */
+	this->offsets.assign(n + 1, 0);
+	this->edges.reserve(raw.size());
+	for (int i = 0; i < n; i++) {
+		auto slice_begin = raw.begin() + pos[i], slice_end = raw.begin() + pos[i + 1];
+		sort(slice_begin, slice_end, [](const TEdge &a, const TEdge &b) {
+			if (a.tStart != b.tStart) {
+				return a.tStart < b.tStart;
+			}
+			if (a.tStop != b.tStop) {
+				return a.tStop < b.tStop;
+			}
+			return a.nodeTo < b.nodeTo;
+		});
+		slice_end = std::unique(slice_begin, slice_end);
+		this->edges.insert(this->edges.end(), slice_begin, slice_end);
+		this->offsets[i + 1] = (int)(this->edges.size());
+	}
 
-TGraph::TGraph(const TGraph &g2) {
-	this->adj_list = g2.adj_list;
-	this->lifetime_begin = g2.lifetime_begin;
-	this->lifetime_end = g2.lifetime_end;
+	this->max_stop.resize(this->edges.size());
+	for (int i = 0; i < n; i++) {
+		interval_index::build(this->edges.data() + this->offsets[i], this->max_stop.data() + this->offsets[i],
+				      this->offsets[i + 1] - this->offsets[i]);
+	}
+
+	/* Global index: keep the direction with nodeFrom <= nodeTo of every edge */
+	for (const TEdge &e : this->edges) {
+		if (e.nodeFrom <= e.nodeTo) {
+			this->all_edges.push_back(e);
+		}
+	}
+	sort(this->all_edges.begin(), this->all_edges.end(),
+	     [](const TEdge &a, const TEdge &b) { return a.tStart < b.tStart; });
+	this->all_max_stop.resize(this->all_edges.size());
+	interval_index::build(this->all_edges.data(), this->all_max_stop.data(), (long)(this->all_edges.size()));
 }
 
-void TGraph::addNode(NodeId n) {
-	if (this->adj_list.find(n) == this->adj_list.end()) {
-		this->adj_list[n] = unordered_set<TEdge, boost::hash<TEdge>>();
+TGraph::TGraph(GraphFileReader &in) {
+	vector<NodeTime> lifetime = in.read<NodeTime>();
+	this->nodes = NodeIndex(in.read<NodeId>());
+	this->offsets = in.read<int>();
+	this->edges = in.read<TEdge>();
+	this->max_stop = in.read<NodeTime>();
+	this->all_edges = in.read<TEdge>();
+	this->all_max_stop = in.read<NodeTime>();
+
+	if (in.good() && lifetime.size() == 2) {
+		this->lifetime_begin = lifetime[0];
+		this->lifetime_end = lifetime[1];
+	} else {
+		*this = TGraph();
 	}
 }
 
-void TGraph::addEdge(TEdge e) {
-	(this->adj_list[e.nodeFrom]).insert(e);
-	(this->adj_list[e.nodeTo]).insert(TEdge(e.nodeTo, e.nodeFrom, e.tStart, e.tStop));
+void TGraph::write(GraphFileWriter &out) const {
+	out.write(vector<NodeTime>({this->lifetime_begin, this->lifetime_end}));
+	out.write(this->nodes.getIds());
+	out.write(this->offsets);
+	out.write(this->edges);
+	out.write(this->max_stop);
+	out.write(this->all_edges);
+	out.write(this->all_max_stop);
+}
 
-	this->lifetime_begin = min(this->lifetime_begin, e.tStart);
-	this->lifetime_end = max(this->lifetime_end, e.tStop);
+template <typename F> void TGraph::queryContaining(NodeTime t_start, NodeTime t_stop, F f) {
+	interval_index::query(this->all_edges.data(), this->all_max_stop.data(), (long)(this->all_edges.size()), t_stop,
+			      t_start, f);
 }
 
 int TGraph::getNodesCount() {
-	return (int)(this->adj_list.size());
+	return this->nodes.size();
 }
 
 int TGraph::getEdgesCount() {
-	int cnt = 0;
-	for (const auto &l : this->adj_list) {
-		cnt += (int)(l.second.size());
-	}
-
-	return cnt / 2;
+	return (int)(this->edges.size()) / 2;
 }
 
 int TGraph::getEdgesInstantsCount() {
 	int cnt = 0;
-	for (const auto &l : this->adj_list) {
-		for (const TEdge e : l.second) {
-			cnt += e.tStop - e.tStart + 1;
-		}
+	for (const TEdge &e : this->edges) {
+		cnt += e.tStop - e.tStart + 1;
 	}
 
 	return cnt / 2;
@@ -89,64 +156,132 @@ NodeTime TGraph::getLifetimeEnd() {
 }
 
 void TGraph::forallNeighbours(NodeId node, NodeTime t, function<void(NodeId &)> callback, bool parallel) {
-#pragma omp parallel if (parallel)
-	{
-#pragma omp single
-		{
-			for (TEdge n : this->adj_list[node]) {
-				if (n.tStart <= t && t <= n.tStop) {
-#pragma omp task if (parallel)
-					callback(n.nodeTo);
-				}
-			}
-		}
-	}
+	this->forallNeighbours<const function<void(NodeId &)> &>(node, t, callback, parallel);
 }
 
 NodeSet TGraph::getNodes() {
-	NodeSet ret;
-	for (const auto &entry : this->adj_list) {
-		ret.insert(entry.first);
+	return NodeSet(this->nodes.getIds().begin(), this->nodes.getIds().end());
+}
+
+vector<Interval> TGraph::getActiveIntervals() {
+	return this->getActiveIntervals(NODETIME_MIN, NODETIME_MAX);
+}
+
+/* Extends runs, the merged intervals of edges sorted by start time, with the part of e within [t_from, t_to] */
+static void merge_active(vector<Interval> &runs, const TEdge &e, NodeTime t_from, NodeTime t_to) {
+	NodeTime start = max(e.tStart, t_from), stop = min(e.tStop, t_to);
+	if (!runs.empty() && start <= runs.back().second + 1) {
+		runs.back().second = max(runs.back().second, stop);
+	} else {
+		runs.push_back(Interval(start, stop));
+	}
+}
+
+vector<Interval> TGraph::getActiveIntervals(NodeTime t_from, NodeTime t_to) {
+	vector<Interval> runs;
+	if (t_from > t_to) {
+		return runs;
 	}
 
-	return ret;
+	/* Edges overlapping the window come sorted by start time */
+	interval_index::query(this->all_edges.data(), this->all_max_stop.data(), (long)(this->all_edges.size()), t_from,
+			      t_to, [&](const TEdge &e) { merge_active(runs, e, t_from, t_to); });
+
+	return runs;
+}
+
+vector<Interval> TGraph::getActiveIntervals(NodeId node, NodeTime t_from, NodeTime t_to) {
+	vector<Interval> runs;
+	if (t_from > t_to) {
+		return runs;
+	}
+
+	this->query(node, t_from, t_to, [&](const TEdge &e) { merge_active(runs, e, t_from, t_to); });
+
+	return runs;
 }
 
 /* TODO: note here, we do not want "fragmented" edges */
-SGraph TGraph::buildIntersectionGraph(const NodeSet &restriction, NodeTime t_start, NodeTime t_stop) {
-	unordered_set<SEdge, boost::hash<SEdge>> adj;
-	for (NodeId u : restriction) {
-		for (TEdge e : this->adj_list[u]) {
-			if (e.tStart <= t_start && t_stop <= e.tStop) {
-				adj.insert(SEdge(e.nodeFrom, e.nodeTo));
+void TGraph::intersectionEdges(const NodeSet &restriction, NodeTime t_start, NodeTime t_stop, vector<SEdge> &edges) {
+	/* Edges containing [t_start, t_stop]: tStart <= t_start and tStop >= t_stop */
+	if (2 * restriction.size() < (size_t)(this->nodes.size())) {
+		/* Few vertices: query their own slices */
+		for (NodeId u : restriction) {
+			this->query(u, t_stop, t_start,
+				    [&](const TEdge &e) { edges.push_back(SEdge(e.nodeFrom, e.nodeTo)); });
+		}
+	} else {
+		/* Most of the graph: query the global index and keep the edges touching the restriction */
+		vector<char> in(this->nodes.size(), 0);
+		for (NodeId u : restriction) {
+			int i = this->nodes.index(u);
+			if (i >= 0) {
+				in[i] = 1;
 			}
 		}
+
+		this->queryContaining(t_start, t_stop, [&](const TEdge &e) {
+			if (in[this->nodes.index(e.nodeFrom)] || in[this->nodes.index(e.nodeTo)]) {
+				edges.push_back(SEdge(e.nodeFrom, e.nodeTo));
+			}
+		});
 	}
+}
+
+SGraph TGraph::buildIntersectionGraph(const NodeSet &restriction, NodeTime t_start, NodeTime t_stop) {
+	vector<SEdge> edges;
+	this->intersectionEdges(restriction, t_start, t_stop, edges);
 
-	return SGraph(adj);
+	return SGraph(edges);
+}
+
+SGraph TGraph::buildWindowGraph(NodeTime t_start, NodeTime t_stop) {
+	vector<SEdge> edges;
+	this->queryContaining(t_start, t_stop, [&](const TEdge &e) { edges.push_back(SEdge(e.nodeFrom, e.nodeTo)); });
+
+	return SGraph(this->nodes.getIds(), edges);
 }
 
 SGraph TGraph::buildAuxGraph(const NodeSet &restriction, NodeTime t_start, NodeTime t_stop, NodeTime t_crit) {
-	/* First, get all edges in the intersection graph of V \ restriction */
-	NodeSet outer = this->getNodes();
+	return this->buildAuxGraph(this->buildWindowGraph(t_start, t_stop), restriction, t_crit);
+}
+
+SGraph TGraph::buildAuxGraph(const SGraph &window, const NodeSet &restriction, NodeTime t_crit) {
+	/* Dense indices of the restriction, sorted since they follow the NodeId order */
+	vector<int> in;
 	for (NodeId u : restriction) {
-		outer.erase(u);
+		int i = this->nodes.index(u);
+		if (i >= 0) {
+			in.push_back(i);
+		}
 	}
 
-	SGraph intersect = this->buildIntersectionGraph(outer, t_start, t_stop);
+	/*
+	 * Edges with an endpoint outside of the restriction are those of the window graph, while edges internal to
+	 * the restriction shall be valid at the crit time.
+	 */
+	map<int, vector<int>> rows;
+	for (int u : in) {
+		vector<int> &row = rows[u];
+		for (int v : window.row(u)) {
+			if (!std::binary_search(in.begin(), in.end(), v)) {
+				row.push_back(v);
+			}
+		}
 
-	/* Then, add edges internal to the restriction subset which are valid at the crit time */
-	for (NodeId u : restriction) {
-		this->forallNeighbours(u, t_crit,
-				       [&](NodeId v) {
-					       if (restriction.find(v) != restriction.end()) {
-						       intersect.addEdge(SEdge(u, v));
-					       }
-				       },
-				       false);
+		interval_index::query(this->edges.data() + this->offsets[u], this->max_stop.data() + this->offsets[u],
+				      this->offsets[u + 1] - this->offsets[u], t_crit, t_crit, [&](const TEdge &e) {
+					      int v = this->nodes.index(e.nodeTo);
+					      if (std::binary_search(in.begin(), in.end(), v)) {
+						      row.push_back(v);
+					      }
+				      });
+
+		sort(row.begin(), row.end());
+		row.erase(std::unique(row.begin(), row.end()), row.end());
 	}
 
-	return intersect;
+	return SGraph(window, rows);
 }
 
 int TGraph::outdegree(NodeId node, const NodeSet &in, NodeTime t) {
@@ -182,14 +317,12 @@ int TGraph::outdegree_max(NodeId node, const NodeSet &in, NodeTime t_start, Node
 int TGraph::degree_sum(NodeId node, NodeTime t_start, NodeTime t_stop) {
 	int res = 0;
 
-	for (TEdge e : this->adj_list[node]) {
+	this->query(node, t_start, t_stop, [&](const TEdge &e) {
 		NodeTime start = max(t_start, e.tStart);
 		NodeTime stop = min(t_stop, e.tStop);
 
-		if (stop - start >= 0) {
-			res += stop - start + 1;
-		}
-	}
+		res += stop - start + 1;
+	});
 
 	return res;
 }
@@ -197,31 +330,20 @@ int TGraph::degree_sum(NodeId node, NodeTime t_start, NodeTime t_stop) {
 int TGraph::outdegree_time_sum(NodeId node, const NodeSet &restriction, NodeTime t_start, NodeTime t_stop) {
 	int res = 0;
 
-	for (TEdge e : this->adj_list[node]) {
+	this->query(node, t_start, t_stop, [&](const TEdge &e) {
 		if (restriction.find(e.nodeTo) == restriction.end()) {
 			NodeTime start = max(t_start, e.tStart);
 			NodeTime stop = min(t_stop, e.tStop);
 
-			if (stop - start >= 0) {
-				res += stop - start + 1;
-			}
+			res += stop - start + 1;
 		}
-	}
+	});
 
 	return res;
 }
 
 void TGraph::forallNodes(function<void(NodeId)> callback, bool parallel) {
-#pragma omp parallel if (parallel)
-	{
-#pragma omp single
-		{
-			for (const auto &entry : this->adj_list) {
-#pragma omp task if (parallel)
-				callback(entry.first);
-			}
-		}
-	}
+	this->forallNodes<const function<void(NodeId)> &>(callback, parallel);
 }
 
 int TGraph::degree(NodeId node, NodeTime t, const NodeSet &restriction) {
@@ -309,7 +431,13 @@ bool TGraph::isIsolated(const NodeSet &plex, NodeTime t_start, NodeTime t_stop,
 }
 
 map<NodeId, unordered_set<TEdge, boost::hash<TEdge>>> TGraph::getAdjacencyList() {
-	return this->adj_list;
+	map<NodeId, unordered_set<TEdge, boost::hash<TEdge>>> adj_list;
+	for (int u = 0; u < this->nodes.size(); u++) {
+		adj_list[this->nodes.nodeId(u)].insert(this->edges.begin() + this->offsets[u],
+						       this->edges.begin() + this->offsets[u + 1]);
+	}
+
+	return adj_list;
 }
 
 string nodesetinterval_to_string(const NodeSetInterval &nodeset) {
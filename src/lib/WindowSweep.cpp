@@ -0,0 +1,83 @@
+#include <Graph.hpp>
+#include <IntervalIndex.hpp>
+
+#include <algorithm>
+
+using std::min;
+using std::upper_bound;
+
+WindowSweep::WindowSweep(const TGraph &g, NodeTime len, NodeTime b_from, NodeTime b_to)
+    : g(g), len(len), b(b_from), b_to(b_to), cursor(-1), expiry(NODETIME_MAX) {
+}
+
+bool WindowSweep::done() const {
+	return this->b > this->b_to;
+}
+
+void WindowSweep::next() {
+	this->b++;
+}
+
+void WindowSweep::seek(NodeTime b) {
+	this->b = b;
+}
+
+NodeTime WindowSweep::begin() const {
+	return this->b;
+}
+
+NodeTime WindowSweep::end() const {
+	return this->b + this->len - 1;
+}
+
+SGraph WindowSweep::graph() {
+	const vector<TEdge> &all_edges = this->g.all_edges;
+	bool changed = false;
+
+	if (this->cursor < 0) {
+		/* First request: the edges containing the window, then the ones starting later */
+		interval_index::query(all_edges.data(), this->g.all_max_stop.data(), (long)(all_edges.size()),
+				      this->end(), this->b,
+				      [&](const TEdge &e) { this->alive.push_back((int)(&e - all_edges.data())); });
+		this->cursor = (int)(upper_bound(all_edges.begin(), all_edges.end(), this->b,
+						 [](NodeTime t, const TEdge &e) { return t < e.tStart; }) -
+				     all_edges.begin());
+		changed = true;
+	} else {
+		/* Insert the edges started since the last request and lasting at least len instants */
+		for (; this->cursor < (int)(all_edges.size()) && all_edges[this->cursor].tStart <= this->b;
+		     this->cursor++) {
+			const TEdge &e = all_edges[this->cursor];
+			if (e.tStop - this->len + 1 >= this->b) {
+				this->alive.push_back(this->cursor);
+				changed = true;
+			}
+		}
+
+		/* Some edge stops before the end of the window */
+		if (this->expiry < this->b) {
+			changed = true;
+		}
+	}
+
+	if (changed) {
+		/* Drop the expired edges, then rebuild the graph */
+		vector<SEdge> edges;
+		size_t j = 0;
+
+		this->expiry = NODETIME_MAX;
+		for (int i : this->alive) {
+			const TEdge &e = all_edges[i];
+			if (e.tStop - this->len + 1 >= this->b) {
+				this->alive[j++] = i;
+				this->expiry = min(this->expiry, e.tStop - this->len + 1);
+				edges.push_back(SEdge(e.nodeFrom, e.nodeTo));
+			}
+		}
+		this->alive.resize(j);
+
+		this->current = SGraph(this->g.nodes.getIds(), edges);
+	}
+
+	return this->current;
+}
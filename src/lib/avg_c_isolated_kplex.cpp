@@ -5,6 +5,7 @@
 #include <unordered_map>
 
 #include <conf.hpp>
+#include <scheduler.hpp>
 
 using std::max;
 using std::min;
@@ -14,32 +15,34 @@ using std::set_union;
 using std::sort;
 using std::unordered_map;
 
-NodeSetSet avg_isolated_subsets(SGraph &g, int k, int c, NodeSet &candidate, int max_del) {
-	NodeSetSet avg_subsets;
-	vector<NodeId> deg_sorted(candidate.begin(), candidate.end());
-	sort(deg_sorted.begin(), deg_sorted.end(), [&](NodeId a, NodeId b) { return g.degree(a) < g.degree(b); });
+BitsetSet avg_isolated_subsets(SGraph &g, const AdjMatrix &plex_graph, int k, int c, const Bitset &candidate,
+			       int max_del) {
+	BitsetSet avg_subsets;
+	vector<int> deg_sorted;
+	candidate.forall([&](int u) { deg_sorted.push_back(u); });
+	sort(deg_sorted.begin(), deg_sorted.end(),
+	     [&](int a, int b) { return plex_graph.globalDegree(a) < plex_graph.globalDegree(b); });
 
-	NodeSetSet deletions, deletions_prime;
-	deletions_prime.insert(NodeSet());
+	BitsetSet deletions, deletions_prime;
+	deletions_prime.insert(Bitset(plex_graph.size()));
 
-	int mindegree = g.mindegree(candidate);
+	int mindegree = g.mindegree(plex_graph.toNodeSet(candidate));
 	while ((deletions = deletions_prime).size() > 0) {
 		deletions_prime.clear();
-		for (const NodeSet &del : deletions) {
-			NodeSet candidate_del;
-			set_difference(candidate.begin(), candidate.end(), del.begin(), del.end(),
-				       std::inserter(candidate_del, candidate_del.begin()));
-
-			if (g.outdegree_sum(candidate_del) >= (int)(candidate_del.size()) * c) {
-				int max_deletion = min((int)(max_del) - (int)(del.size()),
-						       (mindegree - c - 3 * k) - (int)(del.size()));
+		for (const Bitset &del : deletions) {
+			Bitset candidate_del = candidate;
+			candidate_del -= del;
+			int del_size = del.count();
+
+			if (plex_graph.outdegree_sum(candidate_del) >= candidate_del.count() * c) {
+				int max_deletion = min((int)(max_del)-del_size, (mindegree - c - 3 * k) - del_size);
 				if (max_deletion > 0) {
 					/* Create new deletions sets, adding candidates */
 					for (int idx = max(mindegree - c - 3 * k, 0); idx < (int)(deg_sorted.size());
 					     idx++) {
-						if (del.find(deg_sorted[idx]) == del.end()) {
-							NodeSet delcpy = del;
-							delcpy.insert(deg_sorted[idx]);
+						if (!del.test(deg_sorted[idx])) {
+							Bitset delcpy = del;
+							delcpy.set(deg_sorted[idx]);
 
 							deletions_prime.insert(delcpy);
 						}
@@ -63,195 +66,219 @@ NodeSetSet avg_c_isolated_kplex(SGraph &g, int c, int k) {
 	return avg_c_isolated_kplex_restricted(g, c, k, unrestricted);
 }
 
-NodeSetSet avg_c_isolated_kplex_restricted(SGraph &g, int c, int k, const NodeSet &restriction) {
-	NodeSetSet sol, ret;
-
-#pragma omp parallel if (parallelism)
-	{
-#pragma omp single
-		for (NodeId pivot_node : restriction) {
-			spdlog::trace("Pivot node {}", pivot_node);
-#pragma omp task if (parallelism)
-			{
-				SGraph compl_graph, search_graph;
-				NodeSet pivot_candidate, pivot_neigh, node_set, node_set_restricted;
-
-				/* Candidate set */
-				NodeSet candidate = pivot_neigh = g.neighbourhood(pivot_node);
-				pivot_neigh.insert(pivot_node);
-
-				int pivot_node_deg = candidate.size();
-
-				/* Trimming stage */
-				int max_del = c - 1;
-				bool fixpoint = false;
-				while (!fixpoint) {
-					fixpoint = true;
-					const NodeSet candidate_iter = candidate;
-
-					for (NodeId u : candidate_iter) {
-						int neigh_u_size = g.degree(u, candidate);
-
-						if (restriction.find(u) == restriction.end() ||
-						    g.outdegree(u, candidate) >= (k + (int)candidate.size()) * c ||
-						    neigh_u_size <= pivot_node_deg - c - k) {
-							fixpoint = false;
-							candidate.erase(u);
-							max_del--;
-						}
+static NodeSetSet avg_c_isolated_kplex_component(SGraph &g, int c, int k, const NodeSet &restriction,
+						 const NodeSet &pivots) {
+	/* Plexes found by each pivot task: every slot is written by a single task, then merged */
+	vector<NodeId> pivot_list(pivots.begin(), pivots.end());
+	vector<NodeSetSet> found(pivot_list.size());
 
-						if (max_del < 0) {
-							goto next_pivot;
-						}
-					}
-				}
 
-				/* Enumeration stage */
+	scheduler::parallel_for((long)(pivot_list.size()), [&](long slot) {
+		NodeId pivot_node = pivot_list[slot];
+		spdlog::trace("Pivot node {}", pivot_node);
 
-				/* We are interested in reachable nodes only */
-				node_set = g.getReachableNodes(pivot_node);
-				set_intersection(node_set.begin(), node_set.end(), restriction.begin(),
-						 restriction.end(),
-						 std::inserter(node_set_restricted, node_set_restricted.begin()));
+		NodeSet pivot_candidate, pivot_neigh, node_set, node_set_restricted;
 
-				set_difference(node_set_restricted.begin(), node_set_restricted.end(),
-					       pivot_neigh.begin(), pivot_neigh.end(),
-					       std::inserter(pivot_candidate, pivot_candidate.begin()));
+		/* Candidate set, indexed locally over the pivot neighbourhood */
+		NodeSet candidate = pivot_neigh = g.neighbourhood(pivot_node);
+		pivot_neigh.insert(pivot_node);
 
-				foreach_kplex_pivot(k - 1, pivot_candidate, [&](NodeSet &pivot_set) {
-					NodeSet candidate_plex;
+		int pivot_node_deg = candidate.size();
 
-					pivot_set.insert(pivot_node);
+		AdjMatrix neigh_graph(g, candidate);
+		Bitset candidate_bits(neigh_graph.size());
+		candidate_bits.fill();
 
-					set_union(pivot_set.begin(), pivot_set.end(), candidate.begin(),
-						  candidate.end(),
-						  std::inserter(candidate_plex, candidate_plex.begin()));
+		/* Trimming stage */
+		int max_del = c - 1;
+		bool fixpoint = false;
+		while (!fixpoint) {
+			fixpoint = true;
+			const Bitset candidate_iter = candidate_bits;
 
-					/*
-					 * Compute meaningful k-plexes: a k-plex shall have at least k + 2 vertices
-					 * Moreover, we are interested in connected k-plexes only
-					 */
-					NodeSetSet screening_candidates;
+			for (int u = 0; u < neigh_graph.size(); u++) {
+				if (!candidate_iter.test(u)) {
+					continue;
+				}
 
-					int bdd_max_del = std::min(max_del, (int)(candidate_plex.size()) - k - 2);
+				int neigh_u_size = neigh_graph.degree(u, candidate_bits);
 
-					if (bdd_max_del < 0) {
-						goto next_kplex;
-					} else if (bdd_max_del == 0) {
-						NodeSet plex = candidate_plex;
+				if (restriction.find(neigh_graph.nodeId(u)) == restriction.end() ||
+				    neigh_graph.outdegree(u, candidate_bits) >=
+					(k + candidate_bits.count()) * c ||
+				    neigh_u_size <= pivot_node_deg - c - k) {
+					fixpoint = false;
+					candidate_bits.reset(u);
+					max_del--;
+				}
 
-						if (g.isKplex(plex, k) &&
-						    g.outdegree_sum(plex) < c * (int)(plex.size())) {
-							screening_candidates.insert(plex);
-						}
+				if (max_del < 0) {
+					goto next_pivot;
+				}
+			}
+		}
+		candidate = neigh_graph.toNodeSet(candidate_bits);
 
-					} else {
-						search_graph = g.buildComplement(candidate_plex);
+		/* Enumeration stage */
 
-						NodeSetSet bdd_sets =
-						    min_bdd_d_set(search_graph, bdd_max_del, k - 1, candidate);
+		/* We are interested in reachable nodes only */
+		node_set = kplex_pivot_reach(g, k, max_del, pivot_node, candidate);
+		set_intersection(node_set.begin(), node_set.end(), restriction.begin(),
+				 restriction.end(),
+				 std::inserter(node_set_restricted, node_set_restricted.begin()));
 
-						NodeSet plex;
-						for (const NodeSet &bdd_set : bdd_sets) {
-							plex = candidate_plex;
+		set_difference(node_set_restricted.begin(), node_set_restricted.end(),
+			       pivot_neigh.begin(), pivot_neigh.end(),
+			       std::inserter(pivot_candidate, pivot_candidate.begin()));
 
-							for (NodeId deletion : bdd_set) {
-								plex.erase(deletion);
-							}
+		foreach_kplex_pivot(g, k, max_del, candidate, pivot_candidate, [&](NodeSet &pivot_set) {
+			NodeSet candidate_plex;
 
-							if (!g.isKplex(plex, k)) {
-								spdlog::error("{} is not a {}-plex! bdd-set: {}",
-									      nodeset_to_string(plex), k,
-									      nodeset_to_string(bdd_set));
-							}
+			pivot_set.insert(pivot_node);
 
-							/*
-							 * Forward to screening avg-isolated subsets only
-							 */
+			set_union(pivot_set.begin(), pivot_set.end(), candidate.begin(),
+				  candidate.end(),
+				  std::inserter(candidate_plex, candidate_plex.begin()));
 
-							NodeSetSet isolated_subsets = avg_isolated_subsets(
-							    g, k, c, plex, bdd_max_del - (int)(bdd_set.size()));
+			/*
+			 * Compute meaningful k-plexes: a k-plex shall have at least k + 2 vertices
+			 * Moreover, we are interested in connected k-plexes only
+			 */
+			BitsetSet screening_candidates;
 
-							for (const NodeSet &plex_avg : isolated_subsets) {
-								screening_candidates.insert(plex_avg);
-							}
-						}
+			int bdd_max_del = std::min(max_del, (int)(candidate_plex.size()) - k - 2);
+
+			if (bdd_max_del < 0) {
+				return;
+			}
+
+			/* Local indexing over the candidate plex */
+			AdjMatrix plex_graph(g, candidate_plex);
+			Bitset plex_all(plex_graph.size());
+			plex_all.fill();
+
+			if (bdd_max_del == 0) {
+				if (plex_graph.isKplex(plex_all, k) &&
+				    plex_graph.outdegree_sum(plex_all) < c * plex_all.count()) {
+					screening_candidates.insert(plex_all);
+				}
+
+			} else {
+				BitsetSet bdd_sets = min_bdd_d_set(plex_graph.complement(), bdd_max_del,
+								   k - 1, plex_graph.toBitset(candidate));
+
+				for (const Bitset &bdd_set : bdd_sets) {
+					Bitset plex = plex_all;
+					plex -= bdd_set;
+
+					if (!plex_graph.isKplex(plex, k)) {
+						spdlog::error("{} is not a {}-plex! bdd-set: {}",
+							      nodeset_to_string(plex_graph.toNodeSet(plex)),
+							      k,
+							      nodeset_to_string(plex_graph.toNodeSet(bdd_set)));
 					}
 
-					for (const NodeSet &plex : screening_candidates) {
-						if (!g.isKplex(plex, k)) {
-							spdlog::error("After isolation screening, {} is not a {}-plex!",
-								      nodeset_to_string(plex), k);
-						}
-						/* Screening #1: pivot vertex check */
-						bool maximal = true;
-						for (NodeId u : plex) {
-							if (g.degree(u) < pivot_node_deg && g.outdegree(u, plex) < c) {
-								/* Not maximal - drop */
-								maximal = false;
-								break;
-							}
-						}
+					/*
+					 * Forward to screening avg-isolated subsets only
+					 */
 
-#pragma omp critical(screening_candidates)
-						if (maximal) {
-							sol.insert(plex);
-						} else {
-							spdlog::trace(
-							    "Ignoring k-plex - failed pivot vertex check (rule #1).");
-						}
+					BitsetSet isolated_subsets = avg_isolated_subsets(
+					    g, plex_graph, k, c, plex, bdd_max_del - bdd_set.count());
+
+					for (const Bitset &plex_avg : isolated_subsets) {
+						screening_candidates.insert(plex_avg);
 					}
+				}
+			}
 
-				next_kplex:;
-				});
+			for (const Bitset &plex : screening_candidates) {
+				if (!plex_graph.isKplex(plex, k)) {
+					spdlog::error("After isolation screening, {} is not a {}-plex!",
+						      nodeset_to_string(plex_graph.toNodeSet(plex)), k);
+				}
+				/* Screening #1: pivot vertex check */
+				bool maximal = true;
+				for (int u = 0; u < plex_graph.size(); u++) {
+					if (plex.test(u) && plex_graph.globalDegree(u) < pivot_node_deg &&
+					    plex_graph.outdegree(u, plex) < c) {
+						/* Not maximal - drop */
+						maximal = false;
+						break;
+					}
+				}
 
-			next_pivot:;
+				if (maximal) {
+					NodeSet plex_set = plex_graph.toNodeSet(plex);
+					found[slot].insert(plex_set);
+				} else {
+					spdlog::trace(
+					    "Ignoring k-plex - failed pivot vertex check (rule #1).");
+				}
 			}
-		}
+		});
+
+	next_pivot:;
+	});
+
+	NodeSetSet sol;
+	for (NodeSetSet &f : found) {
+		sol.merge(f);
 	}
 	spdlog::trace("Enumeration stage returned {} {}-plexes", sol.size(), k);
 
-/* Screening #2: maximality */
-#pragma omp parallel if (parallelism)
-	{
-#pragma omp single
-
-		{
-			for (const NodeSet &s : sol) {
-#pragma omp task if (parallelism)
-				{
-					bool is_maximal = true;
-					for (const NodeSet &t : sol) {
-						if (s == t) {
-							continue;
-						}
-						if (t.size() < s.size()) {
-							continue;
-						}
+	/* Screening #2: maximality */
+	return maximal_sets(sol, parallelism);
+}
 
-						NodeSet isect;
-						set_intersection(t.begin(), t.end(), s.begin(), s.end(),
-								 std::inserter(isect, isect.begin()));
+NodeSet avg_c_isolated_kplex_core(SGraph &g, int c, int k, const NodeSet &restriction) {
+	/*
+	 * A node u of such a plex P has at least |P| - k >= 2 neighbours in P, and at most c|P| - 1 outside of it.
+	 * Since |P| <= deg_P(u) + k, (c + 1) deg_P(u) > degree(u) - ck.
+	 */
+	return g.peel(restriction, [&](int degree) {
+		int bound = degree - c * k;
+		return max(2, bound < 0 ? 0 : bound / (c + 1) + 1);
+	});
+}
 
-						if (isect == s) {
-							is_maximal = false;
-						}
+NodeSetSet avg_c_isolated_kplex_restricted(SGraph &g, int c, int k, const NodeSet &restriction) {
+	/*
+	 * A plex is connected, hence it lies within a single connected component: every component is an
+	 * independent job with its own result set. A single component keeps the pivot-level parallelism.
+	 * Nodes outside the core cannot be in any plex and are never pivots; candidates are left untouched.
+	 */
+	NodeSet core = avg_c_isolated_kplex_core(g, c, k, restriction);
+	vector<NodeSet> components = g.groupByComponent(core);
+	vector<NodeSetSet> results(components.size());
+
+	scheduler::parallel_for((long)(components.size()), [&](long slot) {
+		results[slot] = avg_c_isolated_kplex_component(g, c, k, restriction, components[slot]);
+	});
+
+	NodeSetSet ret;
+	for (NodeSetSet &res : results) {
+		ret.merge(res);
+	}
 
-						if (!is_maximal) {
-							spdlog::trace(
-							    "Ignoring k-plex - failed maximality check (rule #2).");
-							break;
-						}
-					}
+	return ret;
+}
 
-					if (is_maximal) {
-#pragma omp critical(ret)
-						ret.insert(s);
-					}
-				}
-			}
+NodeSetSet avg_c_isolated_kplex_seeded(SGraph &g, int c, int k, const NodeSet &restriction, const NodeSet &seeds) {
+	/*
+	 * Pivots out of the core find no plex, so they need not be peeled. The pivots left lie in the component of
+	 * the seeds: a single job. A plex dropped by the maximality screening of the full search is contained in a
+	 * larger one, which holds the seeds too and is found here as well.
+	 */
+	NodeSet seed_pivots = kplex_seed_pivots(g, k, c, seeds), pivots;
+	std::set_intersection(seed_pivots.begin(), seed_pivots.end(), restriction.begin(), restriction.end(),
+			      std::inserter(pivots, pivots.begin()));
+
+	NodeSetSet ret;
+	for (const NodeSet &plex : avg_c_isolated_kplex_component(g, c, k, restriction, pivots)) {
+		if (std::includes(plex.begin(), plex.end(), seeds.begin(), seeds.end())) {
+			ret.insert(plex);
 		}
 	}
 
 	return ret;
-}
\ No newline at end of file
+}
@@ -1,10 +1,13 @@
 #include <isolation_tplexes.hpp>
 
+#include <limits>
+#include <optional>
 #include <spdlog/spdlog.h>
 #include <unordered_map>
 
 #include <conf.hpp>
 #include <isolation_splexes.hpp>
+#include <scheduler.hpp>
 
 #include <iostream>
 using namespace std;
@@ -15,162 +18,322 @@ using std::set_difference;
 using std::sort;
 using std::unordered_map;
 
+/* Number of consecutive windows swept by a single task */
+#define SWEEP_CHUNK 256
+
+/* A node set found isolated over the interval added, which supersedes the interval removed */
+struct IntervalUpdate {
+	NodeSet nodeset;
+	Interval added;
+	Interval removed;
+};
+
+/* Plexes of the restricted search containing every node of seeds, i.e. all of them if seeds is empty */
+static NodeSetSet restricted_kplexes(SGraph &g, int k, int c, TemporalIsolationType isolation,
+				     const NodeSet &restriction, const NodeSet &seeds) {
+	switch (isolation) {
+	case ALLTIME_MAX:
+	case USUALLY_MAX:
+	case MAX_USUALLY:
+		return seeds.empty() ? max_c_isolated_kplex_restricted(g, c, k, restriction)
+				     : max_c_isolated_kplex_seeded(g, c, k, restriction, seeds);
+	default:
+		return seeds.empty() ? avg_c_isolated_kplex_restricted(g, c, k, restriction)
+				     : avg_c_isolated_kplex_seeded(g, c, k, restriction, seeds);
+	}
+}
+
+static NodeSetSet isolated_subsets(TGraph &g, int k, int c, TemporalIsolationType isolation, const NodeSet &nodeset,
+				   NodeTime t_start, NodeTime t_stop, int delta) {
+	switch (isolation) {
+	case ALLTIME_MAX:
+		return alltime_max_isolated_subset(g, nodeset, k, c, t_start, t_stop, delta);
+	case ALLTIME_AVG:
+		return alltime_avg_isolated_subset(g, nodeset, k, c, t_start, t_stop, delta);
+	case USUALLY_MAX:
+		return usually_max_isolated_subset(g, nodeset, k, c, t_start, t_stop, delta);
+	case USUALLY_AVG:
+		return usually_avg_isolated_subset(g, nodeset, k, c, t_start, t_stop, delta);
+	case AVG_ALLTIME:
+		return avg_alltime_isolated_subset(g, nodeset, k, c, t_start, t_stop, delta);
+	case MAX_USUALLY:
+		return max_usually_isolated_subset(g, nodeset, k, c, t_start, t_stop, delta);
+	}
+
+	return NodeSetSet();
+}
+
+/*
+ * Candidates of the instant t containing the seeds, given the intersection graph gg of the instant over every
+ * node
+ */
+static NodeSetSet instant_candidates(TGraph &g, SGraph &gg, int k, int c, TemporalIsolationType isolation,
+				     NodeTime t, const NodeSet &seeds) {
+	/* The window graph spans every node: isolated ones cannot be part of a plex */
+	NodeSet active;
+	for (NodeId u : gg.getNodes()) {
+		if (gg.degree(u) > 0) {
+			active.insert(active.end(), u);
+		}
+	}
+
+	NodeSetSet res = restricted_kplexes(gg, k, c, isolation, active, seeds);
+
+	for (const NodeSet &s : res) {
+		if (!g.isKplex(s, k, t, t)) {
+			spdlog::error("Instant {}, candidate {} is NOT a {}-plex", t, nodeset_to_string(s), k);
+		}
+	}
+	if (res.size() == 0) {
+		spdlog::debug("Instant {}, no candidates found.", t);
+	}
+
+	return res;
+}
+
+/*
+ * Candidates of the window [begin_w, end_w], found within the candidates of its right sub-window
+ * [begin_w + 1, end_w] and of its left one [begin_w, end_w - 1]. window() returns the intersection graph of the
+ * window; it is only called if a sub-window has candidates. The isolated subsets found are appended to updates.
+ * Only the candidates and subsets containing the seeds are kept.
+ */
+template <typename W>
+static NodeSetSet window_candidates(TGraph &g, int k, int c, TemporalIsolationType isolation, NodeTime begin_w,
+				    NodeTime end_w, const NodeSetSet &right, const NodeSetSet &left, W window,
+				    const NodeSet &seeds, vector<IntervalUpdate> &updates) {
+	NodeSetSet res;
+
+	/* Intersection graph of the window, shared by the aux graphs of every candidate */
+	std::optional<SGraph> window_graph;
+
+	for (int i = 0; i < 2; i++) {
+		NodeTime begin = begin_w - i + 1;
+		NodeTime end = end_w - i;
+		NodeTime crit = (i == 1 ? end_w : begin_w);
+
+		const NodeSetSet &candidates = (i == 0 ? right : left);
+
+		if (candidates.empty()) {
+			spdlog::trace("No candidate for interval [{}, {}]", begin, end);
+			continue;
+		}
+
+		for (const NodeSet &candidate : candidates) {
+			if (!window_graph) {
+				window_graph = window();
+			}
+
+			SGraph g_star = g.buildAuxGraph(*window_graph, candidate, crit);
+			NodeSetSet candidate_k_set = restricted_kplexes(g_star, k, c, isolation, candidate, seeds);
+
+			for (const NodeSet &candidate_k : candidate_k_set) {
+				res.insert(candidate_k);
+
+				if (!g.isKplex(candidate_k, k, begin_w, end_w)) {
+					spdlog::error("{} is not a {}-plex in [{}, {}]", nodeset_to_string(candidate_k), k,
+						      begin_w, end_w);
+				}
+
+				NodeSetSet isolated = isolated_subsets(g, k, c, isolation, candidate_k, begin_w, end_w,
+								       g_star.mindegree(candidate_k));
+
+				spdlog::debug("Found {} isolated subsets ({}).", isolated.size(), nodesetset_to_string(isolated));
+				for (const NodeSet &s : isolated) {
+					if (std::includes(s.begin(), s.end(), seeds.begin(), seeds.end())) {
+						updates.push_back({s, Interval(begin_w, end_w), Interval(begin, end)});
+					}
+				}
+			}
+		}
+	}
+
+	return res;
+}
+
+/* Intersection of two increasing lists of disjoint intervals */
+static vector<Interval> intersect_intervals(const vector<Interval> &a, const vector<Interval> &b) {
+	vector<Interval> res;
+	size_t i = 0, j = 0;
+	while (i < a.size() && j < b.size()) {
+		NodeTime start = max(a[i].first, b[j].first), stop = min(a[i].second, b[j].second);
+		if (start <= stop) {
+			res.push_back(Interval(start, stop));
+		}
+		if (a[i].second < b[j].second) {
+			i++;
+		} else {
+			j++;
+		}
+	}
+
+	return res;
+}
+
 NodeSetIntervalSet c_isolated_temporal_kplex(TGraph &g, int k, int c, TemporalIsolationType isolation) {
+	return c_isolated_temporal_kplex(g, k, c, isolation, g.getLifetimeBegin(), g.getLifetimeEnd());
+}
+
+NodeSetIntervalSet c_isolated_temporal_kplex(TGraph &g, int k, int c, TemporalIsolationType isolation,
+					     NodeTime t_from, NodeTime t_to) {
+	return c_isolated_temporal_kplex(g, k, c, isolation, t_from, t_to, NodeSet());
+}
+
+NodeSetIntervalSet c_isolated_temporal_kplex(TGraph &g, int k, int c, TemporalIsolationType isolation,
+					     NodeTime t_from, NodeTime t_to, const NodeSet &seeds) {
 	NodeSetIntervalSet result;
 
-	unordered_map<Interval, NodeSetSet, boost::hash<Interval>> interval_map;
 	unordered_map<NodeSet, set<Interval>, boost::hash<NodeSet>> nodeset_map;
 
 	spdlog::info("Starting c_isolated_temporal_kplex; is parallelism enabled? {}", parallelism);
-	spdlog::info("TGraph lifetime: [{}, {}]", g.getLifetimeBegin(), g.getLifetimeEnd());
-
-#pragma omp parallel for if (parallelism)
-	for (NodeTime i = g.getLifetimeBegin(); i <= g.getLifetimeEnd(); i++) {
-		SGraph gg = g.buildIntersectionGraph(g.getNodes(), i, i);
-
-		NodeSetSet res;
-		switch (isolation) {
-		case ALLTIME_MAX:
-		case USUALLY_MAX:
-		case MAX_USUALLY:
-			res = max_c_isolated_kplex(gg, c, k);
-			break;
-		default:
-			res = avg_c_isolated_kplex(gg, c, k);
+	spdlog::info("TGraph lifetime: [{}, {}], window: [{}, {}]", g.getLifetimeBegin(), g.getLifetimeEnd(), t_from,
+		     t_to);
+
+	/* Every window considered lies within the lifetime clipped to [t_from, t_to] */
+	NodeTime lifetime_begin = max(g.getLifetimeBegin(), t_from), lifetime_end = min(g.getLifetimeEnd(), t_to);
+	NodeTime lifetime = max(lifetime_end - lifetime_begin + 1, 0);
+
+	/*
+	 * Candidates of the intervals of the previous and of the current length, indexed by begin - lifetime_begin.
+	 * Length len only reads length len - 1, and each entry of the current row is written by the thread owning
+	 * that begin, so no lock is needed.
+	 */
+	vector<NodeSetSet> prev_row(lifetime), curr_row(lifetime);
+
+	/*
+	 * Instants are windows of length 1; instants where no edge is alive have no candidate and are skipped, as
+	 * are those where a seed has no edge alive
+	 */
+	vector<Interval> active = g.getActiveIntervals(lifetime_begin, lifetime_end);
+	for (NodeId s : seeds) {
+		active = intersect_intervals(active, g.getActiveIntervals(s, lifetime_begin, lifetime_end));
+	}
+
+	vector<NodeTime> instants;
+	for (const Interval &run : active) {
+		for (NodeTime i = run.first; i <= run.second; i++) {
+			instants.push_back(i);
 		}
+	}
 
-		for (const NodeSet &s : res) {
-#pragma omp critical(interval_map)
-			{
-				interval_map[Interval(i, i)].insert(s);
-				if (!g.isKplex(s, k, i, i)) {
-					spdlog::error("Instant {}, candidate {} is NOT a {}-plex", i,
-						      nodeset_to_string(s), k);
-				}
-			}
+	scheduler::parallel_for(((long)(instants.size()) + SWEEP_CHUNK - 1) / SWEEP_CHUNK, [&](long chunk_id) {
+		size_t chunk = chunk_id * SWEEP_CHUNK;
+		size_t chunk_end = min(chunk + SWEEP_CHUNK, instants.size());
+		WindowSweep w(g, 1, instants[chunk], instants[chunk_end - 1]);
+
+		for (size_t j = chunk; j < chunk_end; j++) {
+			w.seek(instants[j]);
+			NodeTime i = w.begin();
+			SGraph gg = w.graph();
+
+			curr_row[i - lifetime_begin] = instant_candidates(g, gg, k, c, isolation, i, seeds);
 		}
-		if (res.size() == 0) {
-			spdlog::debug("Instant {}, no candidates found.", i);
+	});
+
+	spdlog::info("c_isolated_temporal_kplex: initialization done");
+
+	/* Begins of the intervals of the current length having candidates, in increasing order */
+	vector<NodeTime> frontier;
+	for (NodeTime i : instants) {
+		if (!curr_row[i - lifetime_begin].empty()) {
+			frontier.push_back(i);
 		}
 	}
 
-	spdlog::info("c_isolated_temporal_kplex: initialization done");
+	for (NodeTime len = 2; len <= lifetime && !frontier.empty(); len++) {
+		/* Rows of length len - 1 and len; the current row is empty at this point */
+		prev_row.swap(curr_row);
 
-	for (NodeTime len = 2; len <= g.getLifetimeEnd() - g.getLifetimeBegin() + 1; len++) {
-		NodeTime lifetime_end = g.getLifetimeEnd();
-#pragma omp parallel for if (parallelism)
-		for (NodeTime begin_w = 0; begin_w <= lifetime_end - len + 1; begin_w++) {
-			NodeTime end_w = begin_w + len - 1;
-			for (int i = 0; i < 2; i++) {
-				NodeTime begin = begin_w - i + 1;
-				NodeTime end = end_w - i;
-				NodeTime crit = (i == 1 ? end_w : begin_w);
-
-				if (interval_map.find(Interval(begin, end)) == interval_map.end()) {
-					spdlog::trace("No candidate for interval [{}, {}]", begin, end);
-				} else {
-					for (const NodeSet &candidate : interval_map[Interval(begin, end)]) {
-						SGraph g_star = g.buildAuxGraph(candidate, begin_w, end_w, crit);
-						NodeSetSet candidate_k_set;
-						switch (isolation) {
-						case ALLTIME_MAX:
-						case USUALLY_MAX:
-						case MAX_USUALLY:
-							candidate_k_set =
-							    max_c_isolated_kplex_restricted(g_star, c, k, candidate);
-							break;
-						default:
-							candidate_k_set =
-							    avg_c_isolated_kplex_restricted(g_star, c, k, candidate);
-							break;
-						}
+		/* Only windows extending an interval of the frontier may have candidates */
+		vector<NodeTime> windows;
+		for (NodeTime f : frontier) {
+			if (f > lifetime_begin && (windows.empty() || windows.back() < f - 1)) {
+				windows.push_back(f - 1);
+			}
+			if (f + len - 1 <= lifetime_end) {
+				windows.push_back(f);
+			}
+		}
 
-						for (const NodeSet &candidate_k : candidate_k_set) {
-#pragma omp critical(interval_map)
-							{
-								interval_map[Interval(begin_w, end_w)].insert(
-								    candidate_k);
-
-								if (!g.isKplex(candidate_k, k, begin_w, end_w)) {
-									spdlog::error("{} is not a {}-plex in [{}, {}]",
-										      nodeset_to_string(candidate_k), k,
-										      begin_w, end_w);
-								}
-							}
-							NodeSetSet isolated_subsets;
-
-							switch (isolation) {
-							case ALLTIME_MAX:
-								isolated_subsets = alltime_max_isolated_subset(
-								    g, candidate_k, k, c, begin_w, end_w,
-								    g_star.mindegree(candidate_k));
-								break;
-							case ALLTIME_AVG:
-								isolated_subsets = alltime_avg_isolated_subset(
-								    g, candidate_k, k, c, begin_w, end_w,
-								    g_star.mindegree(candidate_k));
-								break;
-							case USUALLY_MAX:
-								isolated_subsets = usually_max_isolated_subset(
-								    g, candidate_k, k, c, begin_w, end_w,
-								    g_star.mindegree(candidate_k));
-								break;
-							case USUALLY_AVG:
-								isolated_subsets = usually_avg_isolated_subset(
-								    g, candidate_k, k, c, begin_w, end_w,
-								    g_star.mindegree(candidate_k));
-								break;
-
-							case AVG_ALLTIME:
-								isolated_subsets = avg_alltime_isolated_subset(
-								    g, candidate_k, k, c, begin_w, end_w,
-								    g_star.mindegree(candidate_k));
-								break;
-
-							case MAX_USUALLY:
-								isolated_subsets = max_usually_isolated_subset(
-								    g, candidate_k, k, c, begin_w, end_w,
-								    g_star.mindegree(candidate_k));
-								break;
-							}
+		/*
+		 * Updates of nodeset_map found by each chunk of windows, applied once the length is done. Lengths
+		 * len are only inserted and lengths len - 1 only erased, so the order of the updates does not matter.
+		 */
+		vector<vector<IntervalUpdate>> updates((windows.size() + SWEEP_CHUNK - 1) / SWEEP_CHUNK);
+
+		scheduler::parallel_for(((long)(windows.size()) + SWEEP_CHUNK - 1) / SWEEP_CHUNK, [&](long chunk_id) {
+			size_t chunk = chunk_id * SWEEP_CHUNK;
+			size_t chunk_end = min(chunk + SWEEP_CHUNK, windows.size());
+			WindowSweep w(g, len, windows[chunk], windows[chunk_end - 1]);
+
+			for (size_t j = chunk; j < chunk_end; j++) {
+				w.seek(windows[j]);
+				NodeTime begin_w = w.begin();
+				NodeTime end_w = w.end();
+
+				curr_row[begin_w - lifetime_begin] = window_candidates(
+				    g, k, c, isolation, begin_w, end_w, prev_row[begin_w + 1 - lifetime_begin],
+				    prev_row[begin_w - lifetime_begin], [&]() { return w.graph(); }, seeds,
+				    updates[chunk_id]);
+			}
+		});
 
-#pragma omp critical(nodeset_map)
-							{
-								spdlog::debug("Found {} isolated subsets ({}).",
-									      isolated_subsets.size(),
-									      nodesetset_to_string(isolated_subsets));
-								for (const NodeSet &isolated : isolated_subsets) {
-									nodeset_map[isolated].insert(
-									    Interval(begin_w, end_w));
-									nodeset_map[isolated].erase(
-									    Interval(begin, end));
-								}
-							}
-						}
-					}
-				}
+		for (const vector<IntervalUpdate> &chunk_updates : updates) {
+			for (const IntervalUpdate &update : chunk_updates) {
+				set<Interval> &intervals = nodeset_map[update.nodeset];
+				intervals.insert(update.added);
+				intervals.erase(update.removed);
 			}
 		}
 
-		spdlog::info("c_isolated_temporal_kplex enumeration: [{}/{}] interval length done", len,
-			     g.getLifetimeEnd() - g.getLifetimeBegin() + 1);
+		for (NodeTime f : frontier) {
+			prev_row[f - lifetime_begin] = NodeSetSet();
+		}
+
+		frontier.clear();
+		for (NodeTime begin_w : windows) {
+			if (!curr_row[begin_w - lifetime_begin].empty()) {
+				frontier.push_back(begin_w);
+			}
+		}
+
+		spdlog::info("c_isolated_temporal_kplex enumeration: [{}/{}] interval length done, {} intervals left",
+			     len, lifetime, frontier.size());
 	}
 
 	spdlog::info("c_isolated_temporal_kplex: enumeration done");
 
+	/*
+	 * Keep the intervals of each node set not contained in another one. Intervals are sorted by start, then
+	 * end: among those with the same start only the last one may be maximal, and it is iff it ends after every
+	 * interval starting before it.
+	 */
+	vector<const pair<const NodeSet, set<Interval>> *> entries;
+	entries.reserve(nodeset_map.size());
 	for (const auto &r : nodeset_map) {
-		set<Interval> intervals = r.second;
-		for (Interval i1 : r.second) {
-			for (Interval i2 : r.second) {
-				if (i1.first > i2.first || i1.second < i2.second) {
-					intervals.erase(i1);
-					break;
-				}
+		entries.push_back(&r);
+	}
+
+	vector<vector<Interval>> maximal(entries.size());
+	scheduler::parallel_for((long)(entries.size()), [&](long e) {
+		const set<Interval> &intervals = entries[e]->second;
+		NodeTime max_stop = std::numeric_limits<NodeTime>::min();
+
+		for (auto it = intervals.begin(); it != intervals.end(); it++) {
+			auto next = std::next(it);
+			if (next != intervals.end() && next->first == it->first) {
+				continue;
+			}
+
+			if (it->second > max_stop) {
+				maximal[e].push_back(*it);
+				max_stop = it->second;
 			}
 		}
+	});
 
-		for (Interval i : intervals) {
-			result.insert(NodeSetInterval(r.first, i));
+	for (size_t e = 0; e < entries.size(); e++) {
+		for (const Interval &i : maximal[e]) {
+			result.insert(NodeSetInterval(entries[e]->first, i));
 		}
 	}
 
@@ -179,6 +342,110 @@ NodeSetIntervalSet c_isolated_temporal_kplex(TGraph &g, int k, int c, TemporalIs
 	return result;
 }
 
+TemporalKplexStream::TemporalKplexStream(int k, int c, TemporalIsolationType isolation)
+    : k(k), c(c), isolation(isolation), first(0), started(false) {
+}
+
+void TemporalKplexStream::extend(TGraph &g, NodeTime t, NodeSetIntervalSet &found) {
+	if (!this->started) {
+		this->first = t;
+		this->started = true;
+	}
+
+	map<NodeTime, NodeSetSet> next;
+	vector<IntervalUpdate> updates;
+	static const NodeSetSet none;
+
+	SGraph gg = g.buildWindowGraph(t, t);
+	NodeSetSet instant = instant_candidates(g, gg, this->k, this->c, this->isolation, t, NodeSet());
+	if (!instant.empty()) {
+		next[t] = std::move(instant);
+	}
+
+	/*
+	 * Window [b, t] extends its right sub-window [b + 1, t], found just before, and its left one [b, t - 1] of
+	 * the previous column; it may only have candidates if one of them has.
+	 */
+	NodeTime b = t - 1;
+	while (b >= this->first) {
+		auto right = next.find(b + 1);
+		auto left = this->column.find(b);
+
+		if (right == next.end() && left == this->column.end()) {
+			/* Skip to the next begin with left candidates */
+			auto it = this->column.upper_bound(b);
+			if (it == this->column.begin()) {
+				break;
+			}
+			b = std::prev(it)->first;
+			continue;
+		}
+
+		NodeSetSet res = window_candidates(
+		    g, this->k, this->c, this->isolation, b, t, right == next.end() ? none : right->second,
+		    left == this->column.end() ? none : left->second, [&]() { return g.buildWindowGraph(b, t); }, NodeSet(),
+		    updates);
+		if (!res.empty()) {
+			next[b] = std::move(res);
+		}
+		b--;
+	}
+
+	this->column.swap(next);
+
+	/* Keep the intervals not contained in another one: intervals superseded are only dropped from the table */
+	for (const IntervalUpdate &update : updates) {
+		vector<Interval> &intervals = this->pending[update.nodeset];
+		const Interval &added = update.added;
+
+		bool contained = false;
+		for (const Interval &i : intervals) {
+			contained = contained || (i.first <= added.first && added.second <= i.second);
+		}
+		if (contained) {
+			continue;
+		}
+
+		intervals.erase(std::remove_if(intervals.begin(), intervals.end(),
+					       [&](const Interval &i) {
+						       return added.first <= i.first && i.second <= added.second;
+					       }),
+				intervals.end());
+		intervals.push_back(added);
+	}
+
+	/* Sets that are not a k-plex at t are final, unless they have just been found */
+	for (auto it = this->pending.begin(); it != this->pending.end();) {
+		bool current = false;
+		for (const Interval &i : it->second) {
+			current = current || i.second == t;
+		}
+
+		if (!current && !g.isKplex(it->first, this->k, t, t)) {
+			for (const Interval &i : it->second) {
+				found.insert(NodeSetInterval(it->first, i));
+			}
+			it = this->pending.erase(it);
+		} else {
+			it++;
+		}
+	}
+
+	spdlog::debug("c_isolated_temporal_kplex stream: instant {} done, {} intervals ending at it, {} sets pending", t,
+		      this->column.size(), this->pending.size());
+}
+
+void TemporalKplexStream::finish(NodeSetIntervalSet &found) {
+	for (const auto &p : this->pending) {
+		for (const Interval &i : p.second) {
+			found.insert(NodeSetInterval(p.first, i));
+		}
+	}
+
+	this->pending.clear();
+	this->column.clear();
+}
+
 NodeSetSet alltime_max_isolated_subset(TGraph &g, const NodeSet &nodeset, int k, int c, NodeTime t_start,
 				       NodeTime t_stop, int delta) {
 	NodeSet candidate, candidate_prime;
@@ -4,126 +4,203 @@
 #include <unordered_map>
 
 #include <conf.hpp>
+#include <scheduler.hpp>
 
 using std::set_intersection;
 using std::unordered_map;
 
-NodeSetSet max_c_isolated_clique(SGraph &g, int c) {
-	NodeSetSet sol;
+typedef unordered_map<NodeSet, NodeId, boost::hash<NodeSet>> CliqueCandidates;
 
-	unordered_map<NodeSet, NodeId, boost::hash<NodeSet>> screening_candidates;
-	/* Forall pivots, we enumerate the max_c_isolated cliques */
-	g.forallNodes(
-	    [&](NodeId pivot) {
-		    /* Candidate set */
-		    NodeSet candidate = g.neighbourhoodGreaterDeg(pivot);
-		    candidate.insert(pivot);
-
-		    SGraph search_graph;
-		    NodeSetSet enumeration_delete_sets;
-
-		    /* Trimming stage */
-		    bool fixpoint;
-		    int d = 0;
-		    int max_vc_size;
-		    do {
-			    if (d >= c) {
-				    /* We removed too many vertices, the pivot has c outgoing deg */
-				    goto next_pivot;
-			    }
-			    fixpoint = true;
-			    for (NodeId node : candidate) {
-				    /* Invariant (a) */
-				    if (g.degree(node) >= (int)(candidate.size()) + c - 1) {
-					    candidate.erase(node);
-					    d++;
-					    fixpoint = false;
-					    break;
-				    }
-
-				    /* Invariant (b) */
-				    if (g.degree(node, candidate) < (int)(candidate.size()) - c) {
-					    candidate.erase(node);
-					    d++;
-					    fixpoint = false;
-					    break;
-				    }
-			    }
-		    } while (!fixpoint);
-
-		    /* Enumeration stage */
-		    search_graph = g.buildComplement(candidate);
-		    max_vc_size = c - d - 1;
-
-		    enumeration_delete_sets = min_vertex_cover_bounded(search_graph, max_vc_size);
-
-		    for (const NodeSet &dset : enumeration_delete_sets) {
-			    int dd = d;
-			    NodeSet diffset = candidate;
-			    for (NodeId u : dset) {
-				    diffset.erase(u);
-				    dd++;
-			    }
-
-			    /* Check if the resulting clique respects the max-c-isolation condition */
-			    bool fixpoint;
-			    do {
-				    fixpoint = true;
-				    if (dd >= c) {
-					    /* We removed too many nodes - this clique is not max-c */
-					    goto next_candidate;
-				    }
-
-				    for (NodeId u : diffset) {
-					    if (g.outdegree(u, diffset) >= c) {
-						    /* This node violates max-c */
-						    diffset.erase(u);
-						    dd++;
-						    fixpoint = false;
-						    break;
-					    }
-				    }
-			    } while (!fixpoint);
-
-#pragma omp critical(screening_candidates)
-			    { screening_candidates[diffset] = pivot; }
-
-		    next_candidate:;
-		    }
-	    next_pivot:;
-	    },
-	    parallelism);
-
-	/* Screening stage */
-#pragma omp parallel if (parallelism)
-	{
-#pragma omp single
-		{
-			for (const auto &c1 : screening_candidates) {
-				NodeSet vneigh = g.neighbourhoodSmallerDeg(c1.second);
-				bool maximal = true;
-				/* Lemma 5 */
-				for (const auto &c2 : screening_candidates) {
-					if (!maximal) {
-						break;
-					}
-					if (c1.second != c2.second && vneigh.find(c2.second) != vneigh.end()) {
-						NodeSet uneigh = g.neighbourhood(c2.second);
-						NodeSet result;
-						set_intersection(vneigh.begin(), vneigh.end(), uneigh.begin(),
-								 uneigh.end(), std::inserter(result, result.begin()));
-
-						if (result == c1.first) {
-							maximal = false;
-						}
-					}
+/* Max-c-isolated cliques found by pivot, before the screening stage */
+static vector<NodeSet> max_c_isolated_clique_pivot(SGraph &g, int c, NodeId pivot) {
+	vector<NodeSet> found;
+
+	/* Candidate set */
+	NodeSet candidate = g.neighbourhoodGreaterDeg(pivot);
+	candidate.insert(pivot);
+
+	SGraph search_graph;
+	NodeSetSet enumeration_delete_sets;
+
+	/* Trimming stage */
+	bool fixpoint;
+	int d = 0;
+	int max_vc_size;
+	do {
+		if (d >= c) {
+			/* We removed too many vertices, the pivot has c outgoing deg */
+			return found;
+		}
+		fixpoint = true;
+		for (NodeId node : candidate) {
+			/* Invariant (a) */
+			if (g.degree(node) >= (int)(candidate.size()) + c - 1) {
+				candidate.erase(node);
+				d++;
+				fixpoint = false;
+				break;
+			}
+
+			/* Invariant (b) */
+			if (g.degree(node, candidate) < (int)(candidate.size()) - c) {
+				candidate.erase(node);
+				d++;
+				fixpoint = false;
+				break;
+			}
+		}
+	} while (!fixpoint);
+
+	/* Enumeration stage */
+	search_graph = g.buildComplement(candidate);
+	max_vc_size = c - d - 1;
+
+	enumeration_delete_sets = min_vertex_cover_bounded(search_graph, max_vc_size);
+
+	for (const NodeSet &dset : enumeration_delete_sets) {
+		int dd = d;
+		NodeSet diffset = candidate;
+		for (NodeId u : dset) {
+			diffset.erase(u);
+			dd++;
+		}
+
+		/* Check if the resulting clique respects the max-c-isolation condition */
+		bool fixpoint;
+		do {
+			fixpoint = true;
+			if (dd >= c) {
+				/* We removed too many nodes - this clique is not max-c */
+				goto next_candidate;
+			}
+
+			for (NodeId u : diffset) {
+				if (g.outdegree(u, diffset) >= c) {
+					/* This node violates max-c */
+					diffset.erase(u);
+					dd++;
+					fixpoint = false;
+					break;
 				}
-#pragma omp critical(sol)
-				if (maximal) {
-					sol.insert(c1.first);
+			}
+		} while (!fixpoint);
+
+		found.push_back(diffset);
+
+	next_candidate:;
+	}
+
+	return found;
+}
+
+/* Screening stage of the candidates containing seeds, each one keyed by the last pivot finding it */
+static NodeSetSet max_c_isolated_clique_screening(SGraph &g, const CliqueCandidates &screening_candidates,
+						  const NodeSet &seeds) {
+	NodeSetSet sol;
+
+	/* Each iteration flags its own candidate */
+	vector<const pair<const NodeSet, NodeId> *> entries;
+	for (const auto &c1 : screening_candidates) {
+		if (std::includes(c1.first.begin(), c1.first.end(), seeds.begin(), seeds.end())) {
+			entries.push_back(&c1);
+		}
+	}
+	vector<char> maximal_flags(entries.size(), 0);
+
+	scheduler::parallel_for((long)(entries.size()), [&](long i) {
+		const auto &c1 = *entries[i];
+		NodeSet vneigh = g.neighbourhoodSmallerDeg(c1.second);
+		bool maximal = true;
+		/* Lemma 5 */
+		for (const auto &c2 : screening_candidates) {
+			if (!maximal) {
+				break;
+			}
+			if (c1.second != c2.second && vneigh.find(c2.second) != vneigh.end()) {
+				NodeSet uneigh = g.neighbourhood(c2.second);
+				NodeSet result;
+				set_intersection(vneigh.begin(), vneigh.end(), uneigh.begin(),
+						 uneigh.end(), std::inserter(result, result.begin()));
+
+				if (result == c1.first) {
+					maximal = false;
 				}
 			}
 		}
+		maximal_flags[i] = maximal;
+	});
+
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (maximal_flags[i]) {
+			sol.insert(entries[i]->first);
+		}
 	}
+
 	return sol;
-}
\ No newline at end of file
+}
+
+NodeSetSet max_c_isolated_clique(SGraph &g, int c) {
+	CliqueCandidates screening_candidates;
+
+	/* Cliques found by each pivot, indexed by its dense index: every slot is written by a single task */
+	vector<vector<NodeSet>> found(g.getNodesCount());
+	/* Forall pivots, we enumerate the max_c_isolated cliques */
+	g.forallNodes([&](NodeId pivot) { found[g.index(pivot)] = max_c_isolated_clique_pivot(g, c, pivot); },
+		      parallelism);
+
+	/* Merge in pivot order: the last pivot finding a clique is kept, as in a sequential run */
+	for (int i = 0; i < (int)(found.size()); i++) {
+		for (const NodeSet &diffset : found[i]) {
+			screening_candidates[diffset] = g.nodeId(i);
+		}
+	}
+
+	return max_c_isolated_clique_screening(g, screening_candidates, NodeSet());
+}
+
+NodeSetSet max_c_isolated_clique_seeded(SGraph &g, int c, const NodeSet &seeds) {
+	/*
+	 * A clique lies within the neighbourhood of the pivots finding it, so the cliques containing the seeds are
+	 * found by the pivots adjacent to all of them. Their screening reads the keys of the neighbours of such
+	 * pivots, and the other pivots finding a non-empty clique of a neighbour are within two hops of it.
+	 */
+	NodeSet near = g.commonBall(seeds, 1);
+	vector<NodeId> pivots;
+	for (NodeId u : g.ball(near, 3)) {
+		if (g.index(u) >= 0) {
+			pivots.push_back(u);
+		}
+	}
+
+	vector<vector<NodeSet>> found(pivots.size());
+	scheduler::parallel_for((long)(pivots.size()), [&](long slot) {
+		found[slot] = max_c_isolated_clique_pivot(g, c, pivots[slot]);
+	});
+
+	/* Node ids follow the dense indices: pivots are merged in pivot order */
+	CliqueCandidates screening_candidates;
+	for (size_t i = 0; i < pivots.size(); i++) {
+		for (const NodeSet &diffset : found[i]) {
+			screening_candidates[diffset] = pivots[i];
+		}
+	}
+
+	/* The empty clique may be found anywhere: its key is the last pivot finding it over the whole graph */
+	auto empty = screening_candidates.find(NodeSet());
+	if (empty != screening_candidates.end()) {
+		for (int i = g.getNodesCount() - 1; i > g.index(empty->second); i--) {
+			NodeId u = g.nodeId(i);
+			if (std::binary_search(pivots.begin(), pivots.end(), u)) {
+				continue;
+			}
+
+			vector<NodeSet> cliques = max_c_isolated_clique_pivot(g, c, u);
+			if (std::find(cliques.begin(), cliques.end(), NodeSet()) != cliques.end()) {
+				empty->second = u;
+				break;
+			}
+		}
+	}
+
+	return max_c_isolated_clique_screening(g, screening_candidates, seeds);
+}
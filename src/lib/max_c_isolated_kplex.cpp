@@ -5,6 +5,7 @@
 #include <unordered_map>
 
 #include <conf.hpp>
+#include <scheduler.hpp>
 
 using std::set_difference;
 using std::set_intersection;
@@ -16,277 +17,275 @@ NodeSetSet max_c_isolated_kplex(SGraph &g, int c, int k) {
 	return max_c_isolated_kplex_restricted(g, c, k, unrestricted);
 }
 
-NodeSetSet max_c_isolated_kplex_restricted(SGraph &g, int c, int k, const NodeSet &restriction) {
-	NodeSetSet sol, ret;
-#pragma omp parallel if (parallelism)
-
-	{
-#pragma omp single
-		for (NodeId pivot_node : restriction) {
-			spdlog::trace("Pivot node {}", pivot_node);
-#pragma omp task if (parallelism)
-			{
-				SGraph compl_graph, search_graph;
-				NodeSet pivot_candidate, pivot_neigh, node_set, node_set_restricted;
+static NodeSetSet max_c_isolated_kplex_component(SGraph &g, int c, int k, const NodeSet &restriction,
+						 const NodeSet &pivots) {
+	/* Plexes found by each pivot task: every slot is written by a single task, then merged */
+	vector<NodeId> pivot_list(pivots.begin(), pivots.end());
+	vector<NodeSetSet> found(pivot_list.size());
 
-				/* Candidate set */
-				NodeSet candidate = pivot_neigh = g.neighbourhood(pivot_node);
-				pivot_neigh.insert(pivot_node);
+	scheduler::parallel_for((long)(pivot_list.size()), [&](long slot) {
+		NodeId pivot_node = pivot_list[slot];
+		spdlog::trace("Pivot node {}", pivot_node);
 
-				int pivot_node_deg = candidate.size();
+		NodeSet pivot_candidate, pivot_neigh, node_set, node_set_restricted;
 
-				/* Trimming stage */
-				int max_del = c - 1;
-				bool fixpoint = false;
+		/* Candidate set, indexed locally over the pivot neighbourhood */
+		NodeSet candidate = pivot_neigh = g.neighbourhood(pivot_node);
+		pivot_neigh.insert(pivot_node);
 
-				while (!fixpoint) {
-					fixpoint = true;
-					const NodeSet candidate_iter = candidate;
+		int pivot_node_deg = candidate.size();
 
-					for (NodeId u : candidate_iter) {
-						int neigh_u_size = g.degree(u, candidate);
+		AdjMatrix neigh_graph(g, candidate);
+		Bitset candidate_bits(neigh_graph.size());
+		candidate_bits.fill();
 
-						if (restriction.find(u) == restriction.end() ||
-						    neigh_u_size <= pivot_node_deg - c - k ||
-						    g.outdegree(u, candidate) > c + k) {
-							fixpoint = false;
-							candidate.erase(u);
-							max_del--;
-						}
-						if (max_del < 0) {
-							goto next_pivot;
-						}
-					}
+		/* Trimming stage */
+		int max_del = c - 1;
+		bool fixpoint = false;
+
+		while (!fixpoint) {
+			fixpoint = true;
+			const Bitset candidate_iter = candidate_bits;
+
+			for (int u = 0; u < neigh_graph.size(); u++) {
+				if (!candidate_iter.test(u)) {
+					continue;
 				}
 
-				/* Enumeration stage */
-
-				/* We are interested in reachable nodes only */
-				node_set = g.getReachableNodes(pivot_node);
-				set_intersection(node_set.begin(), node_set.end(), restriction.begin(),
-						 restriction.end(),
-						 std::inserter(node_set_restricted, node_set_restricted.begin()));
-
-				set_difference(node_set_restricted.begin(), node_set_restricted.end(),
-					       pivot_neigh.begin(), pivot_neigh.end(),
-					       std::inserter(pivot_candidate, pivot_candidate.begin()));
-
-				foreach_kplex_pivot(k - 1, pivot_candidate, [&](NodeSet &pivot_set) {
-					NodeSet candidate_plex;
-					pivot_set.insert(pivot_node);
-
-					set_union(pivot_set.begin(), pivot_set.end(), candidate.begin(),
-						  candidate.end(),
-						  std::inserter(candidate_plex, candidate_plex.begin()));
-
-#if 0
-					/*
-					 * Remove vertices which cannot be in a max-c-isolated plex
-					 */
-					{
-						int max_del_cpy = max_del;
-						const NodeSet candidate_plex_iter = candidate_plex;
-						for (NodeId u : candidate_plex_iter) {
-							if (g.outdegree(u, candidate_plex) >= c) {
-								candidate_plex.erase(u);
-								max_del_cpy--;
-							}
-							if (max_del_cpy < 0) {
-								spdlog::trace("Dropping candidate k-plex - cannot be "
-									      "max-{}-isolated. "
-									      "Set: {}, max deletion: {}",
-									      c, nodeset_to_string(candidate_plex_iter),
-									      max_del);
-								return;
-							}
-						}
-					}
-#endif
+				int neigh_u_size = neigh_graph.degree(u, candidate_bits);
 
-					/*
-					 * Compute meaningful k-plexes: a k-plex shall have at least k + 2 vertices
-					 * Moreover, we are interested in connected k-plexes only
-					 */
-					NodeSetSet screening_candidates;
+				if (restriction.find(neigh_graph.nodeId(u)) == restriction.end() ||
+				    neigh_u_size <= pivot_node_deg - c - k ||
+				    neigh_graph.outdegree(u, candidate_bits) > c + k) {
+					fixpoint = false;
+					candidate_bits.reset(u);
+					max_del--;
+				}
+				if (max_del < 0) {
+					goto next_pivot;
+				}
+			}
+		}
+		candidate = neigh_graph.toNodeSet(candidate_bits);
 
-					int bdd_max_del = std::min(max_del, (int)(candidate_plex.size()) - k - 2);
+		/* Enumeration stage */
 
-					if (bdd_max_del < 0) {
-						goto next_kplex;
-					} else {
-						NodeSetSet bdd_sets;
+		/* We are interested in reachable nodes only */
+		node_set = kplex_pivot_reach(g, k, max_del, pivot_node, candidate);
+		set_intersection(node_set.begin(), node_set.end(), restriction.begin(),
+				 restriction.end(),
+				 std::inserter(node_set_restricted, node_set_restricted.begin()));
 
-						if (bdd_max_del == 0) {
-							NodeSet empty;
-							if (g.isKplex(candidate_plex, k)) {
-								bdd_sets.insert(empty);
-							}
-						} else {
-							search_graph = g.buildComplement(candidate_plex);
+		set_difference(node_set_restricted.begin(), node_set_restricted.end(),
+			       pivot_neigh.begin(), pivot_neigh.end(),
+			       std::inserter(pivot_candidate, pivot_candidate.begin()));
 
-							bdd_sets =
-							    min_bdd_d_set(search_graph, bdd_max_del, k - 1, candidate);
-						}
-#ifdef DEBUG_23MAY
-						{
-							if (candidate_plex.size() > DEBUG_23MAY) {
-								spdlog::info("Found {} bdd-{} set with max size {}, "
-									     "candidate set size {}",
-									     bdd_sets.size(), k - 1, max_del,
-									     candidate.size());
-							}
-							spdlog::trace("Found {} bdd-{} set with max size {}, candidate "
-								      "set size {}",
-								      bdd_sets.size(), k - 1, max_del,
-								      candidate.size());
-						}
-#endif
+		foreach_kplex_pivot(g, k, max_del, candidate, pivot_candidate, [&](NodeSet &pivot_set) {
+			NodeSet candidate_plex;
+			pivot_set.insert(pivot_node);
 
-						for (const NodeSet &bdd_set : bdd_sets) {
-							NodeSet plex = candidate_plex;
+			set_union(pivot_set.begin(), pivot_set.end(), candidate.begin(),
+				  candidate.end(),
+				  std::inserter(candidate_plex, candidate_plex.begin()));
 
-							for (NodeId deletion : bdd_set) {
-								plex.erase(deletion);
-							}
+			/*
+			 * Compute meaningful k-plexes: a k-plex shall have at least k + 2 vertices
+			 * Moreover, we are interested in connected k-plexes only
+			 */
+			BitsetSet screening_candidates;
 
-							if (!g.isKplex(plex, k)) {
-								spdlog::error("bdd enumerated a set which is not a "
-									      "plex! {}; candidate is {}, bdd is {}",
-									      nodeset_to_string(plex),
-									      nodeset_to_string(candidate_plex),
-									      nodeset_to_string(bdd_set));
-							}
+			int bdd_max_del = std::min(max_del, (int)(candidate_plex.size()) - k - 2);
 
-							int max_del_screening = bdd_max_del - (int)(bdd_set.size());
-							if (max_del_screening < 0) {
-								spdlog::error("max del screening < 0");
-							}
+			if (bdd_max_del < 0) {
+				return;
+			}
 
-							NodeSet plex_prime = plex;
-							bool fixpoint = false;
-							while (!fixpoint) {
-								fixpoint = true;
-								for (NodeId u : plex_prime) {
-									if (g.outdegree(u, plex) >= c) {
-										fixpoint = false;
-										if (candidate.find(u) !=
-										    candidate.end()) {
-											/* This vertex is in the
-											 * candidate set, try to remove
-											 * it */
-											plex.erase(u);
-											max_del_screening--;
-
-											if (max_del_screening < 0) {
-												/* Too many vertices
-												 * removed */
-												goto break_outer_loop;
-											}
-										} else {
-											/* This vertex is in the pivot
-											 * set, drop the plex */
-											goto break_outer_loop;
-										}
-									}
-								}
-								plex_prime = plex;
-							}
-						break_outer_loop:
+			/* Local indexing over the candidate plex */
+			AdjMatrix plex_graph(g, candidate_plex);
+			Bitset plex_candidate = plex_graph.toBitset(candidate);
+			Bitset plex_all(plex_graph.size());
+			plex_all.fill();
 
-							if (fixpoint) {
-								screening_candidates.insert(plex);
-							}
-						}
-					}
+			BitsetSet bdd_sets;
 
-					for (const NodeSet &plex : screening_candidates) {
+			if (bdd_max_del == 0) {
+				if (plex_graph.isKplex(plex_all, k)) {
+					bdd_sets.insert(Bitset(plex_graph.size()));
+				}
+			} else {
+				bdd_sets = min_bdd_d_set(plex_graph.complement(), bdd_max_del, k - 1,
+							 plex_candidate);
+			}
+#ifdef DEBUG_23MAY
+			{
+				if (candidate_plex.size() > DEBUG_23MAY) {
+					spdlog::info("Found {} bdd-{} set with max size {}, "
+						     "candidate set size {}",
+						     bdd_sets.size(), k - 1, max_del, candidate.size());
+				}
+				spdlog::trace("Found {} bdd-{} set with max size {}, candidate "
+					      "set size {}",
+					      bdd_sets.size(), k - 1, max_del, candidate.size());
+			}
+#endif
 
-						if (!g.isKplex(plex, k)) {
-							spdlog::error("After isolation screening, {} is not a {}-plex", nodeset_to_string(plex), k);
-						}
-						/* Screening #0: is max-c-isolated? */
-						bool isolated = true;
-						for (NodeId u : plex) {
-							if (g.outdegree(u, plex) >= c) {
-								isolated = false;
-								break;
-							}
-						}
+			for (const Bitset &bdd_set : bdd_sets) {
+				Bitset plex = plex_all;
+				plex -= bdd_set;
 
-						/* Screening #1: pivot vertex check */
-						if (isolated) {
-							bool maximal = true;
-							for (NodeId u : plex) {
-								if (g.degree(u) < pivot_node_deg &&
-								    g.outdegree(u, plex) < c) {
-									/* Not maximal - drop */
-									maximal = false;
-									break;
-								}
-							}
+				if (!plex_graph.isKplex(plex, k)) {
+					spdlog::error("bdd enumerated a set which is not a "
+						      "plex! {}; candidate is {}, bdd is {}",
+						      nodeset_to_string(plex_graph.toNodeSet(plex)),
+						      nodeset_to_string(candidate_plex),
+						      nodeset_to_string(plex_graph.toNodeSet(bdd_set)));
+				}
+
+				int max_del_screening = bdd_max_del - bdd_set.count();
+				if (max_del_screening < 0) {
+					spdlog::error("max del screening < 0");
+				}
 
-							if (maximal) {
-#pragma omp critical(sol)
-								sol.insert(plex);
+				Bitset plex_prime = plex;
+				bool fixpoint = false;
+				while (!fixpoint) {
+					fixpoint = true;
+					for (int u = 0; u < plex_graph.size(); u++) {
+						if (!plex_prime.test(u)) {
+							continue;
+						}
+						if (plex_graph.outdegree(u, plex) >= c) {
+							fixpoint = false;
+							if (plex_candidate.test(u)) {
+								/* This vertex is in the
+								 * candidate set, try to remove
+								 * it */
+								plex.reset(u);
+								max_del_screening--;
+
+								if (max_del_screening < 0) {
+									/* Too many vertices
+									 * removed */
+									goto break_outer_loop;
+								}
 							} else {
-								spdlog::trace("Ignoring k-plex - failed pivot vertex "
-									      "check (rule #1).");
+								/* This vertex is in the pivot
+								 * set, drop the plex */
+								goto break_outer_loop;
 							}
-						} else {
-							spdlog::error(
-							    "Ignoring k-plex - is not max-{}-isolated. Set: {}", c,
-							    nodeset_to_string(plex));
 						}
 					}
+					plex_prime = plex;
+				}
+			break_outer_loop:
 
-				next_kplex:;
-				});
-
-			next_pivot:;
+				if (fixpoint) {
+					screening_candidates.insert(plex);
+				}
 			}
-		}
-	}
-	spdlog::trace("Enumeration stage returned {} {}-plexes", sol.size(), k);
-
-	/* Screening #2: maximality */
-#pragma omp parallel if (parallelism)
-	{
-#pragma omp single
-		{
-			for (const NodeSet &s : sol) {
-#pragma omp task if (parallelism)
-				{
-					bool is_maximal = true;
-					for (const NodeSet &t : sol) {
-						if (s == t) {
-							continue;
-						}
-						if (t.size() < s.size()) {
-							continue;
-						}
 
-						NodeSet isect;
-						set_intersection(t.begin(), t.end(), s.begin(), s.end(),
-								 std::inserter(isect, isect.begin()));
+			for (const Bitset &plex : screening_candidates) {
 
-						if (isect == s) {
-							is_maximal = false;
-						}
+				if (!plex_graph.isKplex(plex, k)) {
+					spdlog::error("After isolation screening, {} is not a {}-plex",
+						      nodeset_to_string(plex_graph.toNodeSet(plex)), k);
+				}
+				/* Screening #0: is max-c-isolated? */
+				bool isolated = true;
+				for (int u = 0; u < plex_graph.size(); u++) {
+					if (plex.test(u) && plex_graph.outdegree(u, plex) >= c) {
+						isolated = false;
+						break;
+					}
+				}
 
-						if (!is_maximal) {
-							spdlog::trace(
-							    "Ignoring k-plex - failed maximality check (rule #2).");
+				/* Screening #1: pivot vertex check */
+				if (isolated) {
+					bool maximal = true;
+					for (int u = 0; u < plex_graph.size(); u++) {
+						if (plex.test(u) &&
+						    plex_graph.globalDegree(u) < pivot_node_deg &&
+						    plex_graph.outdegree(u, plex) < c) {
+							/* Not maximal - drop */
+							maximal = false;
 							break;
 						}
 					}
 
-					if (is_maximal) {
-#pragma omp critical(ret)
-						ret.insert(s);
+					if (maximal) {
+						NodeSet plex_set = plex_graph.toNodeSet(plex);
+						found[slot].insert(plex_set);
+					} else {
+						spdlog::trace("Ignoring k-plex - failed pivot vertex "
+							      "check (rule #1).");
 					}
+				} else {
+					spdlog::error(
+					    "Ignoring k-plex - is not max-{}-isolated. Set: {}", c,
+					    nodeset_to_string(plex_graph.toNodeSet(plex)));
 				}
 			}
+		});
+
+	next_pivot:;
+	});
+
+	NodeSetSet sol;
+	for (NodeSetSet &f : found) {
+		sol.merge(f);
+	}
+	spdlog::trace("Enumeration stage returned {} {}-plexes", sol.size(), k);
+
+	/* Screening #2: maximality */
+	return maximal_sets(sol, parallelism);
+}
+
+NodeSet max_c_isolated_kplex_core(SGraph &g, int c, const NodeSet &restriction) {
+	/*
+	 * A node u of such a plex P has at least |P| - k >= 2 neighbours in P, and less than c outside of it, i.e.
+	 * at least degree(u) - c + 1 in P
+	 */
+	return g.peel(restriction, [&](int degree) { return std::max(2, degree - c + 1); });
+}
+
+NodeSetSet max_c_isolated_kplex_restricted(SGraph &g, int c, int k, const NodeSet &restriction) {
+	/*
+	 * A plex is connected, hence it lies within a single connected component: every component is an
+	 * independent job with its own result set. A single component keeps the pivot-level parallelism.
+	 * Nodes outside the core cannot be in any plex and are never pivots; candidates are left untouched.
+	 */
+	NodeSet core = max_c_isolated_kplex_core(g, c, restriction);
+	vector<NodeSet> components = g.groupByComponent(core);
+	vector<NodeSetSet> results(components.size());
+
+	scheduler::parallel_for((long)(components.size()), [&](long slot) {
+		results[slot] = max_c_isolated_kplex_component(g, c, k, restriction, components[slot]);
+	});
+
+	NodeSetSet ret;
+	for (NodeSetSet &res : results) {
+		ret.merge(res);
+	}
+
+	return ret;
+}
+
+NodeSetSet max_c_isolated_kplex_seeded(SGraph &g, int c, int k, const NodeSet &restriction, const NodeSet &seeds) {
+	/*
+	 * Pivots out of the core find no plex, so they need not be peeled. The pivots left lie in the component of
+	 * the seeds: a single job. A plex dropped by the maximality screening of the full search is contained in a
+	 * larger one, which holds the seeds too and is found here as well.
+	 */
+	NodeSet seed_pivots = kplex_seed_pivots(g, k, c, seeds), pivots;
+	std::set_intersection(seed_pivots.begin(), seed_pivots.end(), restriction.begin(), restriction.end(),
+			      std::inserter(pivots, pivots.begin()));
+
+	NodeSetSet ret;
+	for (const NodeSet &plex : max_c_isolated_kplex_component(g, c, k, restriction, pivots)) {
+		if (std::includes(plex.begin(), plex.end(), seeds.begin(), seeds.end())) {
+			ret.insert(plex);
 		}
 	}
+
 	return ret;
-}
\ No newline at end of file
+}
@@ -1,125 +1,144 @@
 #include <isolation_splexes.hpp>
 
-#include <algorithm>
-#include <memory>
-
 #include <Graph.hpp>
 
-using std::make_shared;
-using std::set_difference;
+#include <climits>
 
-bool is_min_bdd_d(SGraph &g, NodeSet &deletion, int d) {
-	bool crit = true;
-	g.forallNodes([&](NodeId u) {
-		int deg = g.outdegree(u, deletion);
-		if (deg > d) {
-			crit = false;
-		}
-	}, false);
+/*
+ * Bounded-degree deletion search over the complement graph. A deletion set is a solution when every vertex,
+ * deleted or not, has at most d neighbours out of it; otherwise the lowest non-deleted violating vertex u is
+ * fixed by deleting u or one of its neighbours in the candidate set.
+ *
+ * The number of neighbours out of the deletion set and the violating vertices are maintained on every
+ * insertion and removal. The outcome of a branch only depends on its deletion set, so deletion sets reached
+ * through a different order are not searched again.
+ */
+struct BddSearch {
+	const AdjMatrix &g;
+	int d;
+	const Bitset &candidate_set;
+	BitsetSet &result;
 
-	return crit;
-}
+	Bitset deletion;
+	vector<int> outdeg;
+
+	/* Number of violating vertices, and the violating vertices out of the deletion set */
+	int violations;
+	Bitset pending;
+
+	BitsetSet visited;
 
-void min_bdd_search(SGraph &g, NodeSet &deletion, int d, int k, NodeSet &candidate_set, NodeSetSet &result) {
-	if (is_min_bdd_d(g, deletion, d)) {
-		/* Add to solution set and prune */
-		result.insert(deletion);
-	} else if (k > 0) {
-		bool flag_1 = true, flag_2 = true;
-		g.forallNodes([&](NodeId u) {
-			if (flag_1) {
-				if (deletion.find(u) != deletion.end()) {
-					/* Skip nodes which are already part of the minbdd */
-					return;
+	BddSearch(const AdjMatrix &g, int d, const Bitset &candidate_set, const Bitset &kernel, BitsetSet &result)
+	    : g(g), d(d), candidate_set(candidate_set), result(result), deletion(kernel), outdeg(g.size()),
+	      violations(0), pending(g.size()) {
+		for (int u = 0; u < g.size(); u++) {
+			this->outdeg[u] = g.outdegree(u, kernel);
+			if (this->outdeg[u] > d) {
+				this->violations++;
+				if (!kernel.test(u)) {
+					this->pending.set(u);
 				}
+			}
+		}
+	}
 
-				if (g.outdegree(u, deletion) > d) {
-					/* Recursion */
-					g.forallNeighbours(u, [&](NodeId v) {
-						if (flag_2) {
-							if (deletion.find(v) != deletion.end()) {
-								return;
-							}
-
-							if (candidate_set.find(v) == candidate_set.end()) {
-								/* We cannot delete vertices which do not belong to the
-								 * candidate set */
-								return;
-							}
-
-							/*
-							 * We will need to work on a copy if we will go parallel
-							 *
-							 * NodeSet deletion_cpy = deletion;
-							 * deletion_cpy.insert(v);
-							 */
-							deletion.insert(v);
-							min_bdd_search(g, deletion, d, k - 1, candidate_set, result);
-							deletion.erase(v);
-						}
-					}, false);
-
-					deletion.insert(u);
-					min_bdd_search(g, deletion, d, k - 1, candidate_set, result);
-					deletion.erase(u);
-
-					flag_1 = false;
+	void remove(int v) {
+		this->deletion.set(v);
+		this->pending.reset(v);
+		this->g.row(v).forall([&](int w) {
+			if (this->outdeg[w]-- == this->d + 1) {
+				this->violations--;
+				this->pending.reset(w);
+			}
+		});
+	}
+
+	void restore(int v) {
+		this->g.row(v).forall([&](int w) {
+			if (++this->outdeg[w] == this->d + 1) {
+				this->violations++;
+				if (!this->deletion.test(w)) {
+					this->pending.set(w);
 				}
 			}
-		}, false);
+		});
+		this->deletion.reset(v);
+		if (this->outdeg[v] > this->d) {
+			this->pending.set(v);
+		}
 	}
-}
 
-NodeSetSet min_bdd_d_set(SGraph &g, int max_del, int d, NodeSet &candidate_set) {
-	NodeSetSet sol, ret;
+	void search(int k) {
+		if (!this->visited.insert(this->deletion).second) {
+			return;
+		}
+
+		if (this->violations == 0) {
+			/* Add to solution set and prune */
+			this->result.insert(this->deletion);
+			return;
+		}
+
+		int u = this->pending.first();
+		if (k <= 0 || u < 0) {
+			return;
+		}
+
+		/* Recursion: only vertices of the candidate set can be deleted */
+		Bitset branches = this->g.row(u);
+		branches &= this->candidate_set;
+		branches -= this->deletion;
+
+		branches.forall([&](int v) {
+			this->remove(v);
+			this->search(k - 1);
+			this->restore(v);
+		});
+
+		this->remove(u);
+		this->search(k - 1);
+		this->restore(u);
+	}
+};
+
+BitsetSet min_bdd_d_set(const AdjMatrix &g, int max_del, int d, const Bitset &candidate_set) {
+	BitsetSet sol, ret;
 	/*
 	 * First step: remove all vertices with a degree greater than k + d.
 	 * They necessairly are in the solution of every min bdd
 	 */
 	int curr_k = max_del;
-	NodeSet kernel;
-	bool skip = false;
+	Bitset kernel(g.size());
 
-	g.forallNodes([&](NodeId u) {
-		if (g.degree(u) > max_del + d) {
-			if (candidate_set.find(u) != candidate_set.end()) {
-				kernel.insert(u);
+	for (int u = 0; u < g.size(); u++) {
+		if (g.globalDegree(u) > max_del + d) {
+			if (candidate_set.test(u)) {
+				kernel.set(u);
 				curr_k--;
 			} else {
 				/* We cannot remove vertices which do not belong to the candidate set */
-				skip = true;
+				return sol;
 			}
 		}
-	}, false);
+	}
 
-	if (curr_k < 0 || skip) {
+	if (curr_k < 0) {
 		return sol;
 	}
 
 	/* Second step: start enumerating in bdd */
-	min_bdd_search(g, kernel, d, max_del, candidate_set, sol);
-
-	/* Third step: maximality check */
-	for (const NodeSet &s : sol) {
-		bool maximal = true;
-		for (const NodeSet &t : sol) {
-			if (s == t || s.size() > t.size()) {
-				continue;
-			}
-			if (s.size() < t.size()) {
-				maximal = false;
-				break;
-			}
+	BddSearch(g, d, candidate_set, kernel, sol).search(max_del);
 
-			NodeSet intr;
-			set_difference(s.begin(), s.end(), t.begin(), t.end(), std::inserter(intr, intr.begin()));
-			if (intr.size() == 0) {
-				maximal = false;
-				break;
-			}
-		}
-
-		if (maximal) {
+	/*
+	 * Third step: maximality check. A set is dropped as soon as a larger one exists, and a distinct set of
+	 * the same size never contains it: only the largest sets are kept.
+	 */
+	int max_size = -1;
+	for (const Bitset &s : sol) {
+		max_size = std::max(max_size, s.count());
+	}
+	for (const Bitset &s : sol) {
+		if (s.count() == max_size) {
 			ret.insert(s);
 		}
 	}
@@ -127,28 +146,149 @@ NodeSetSet min_bdd_d_set(SGraph &g, int max_del, int d, NodeSet &candidate_set)
 	return ret;
 }
 
-void foreach_kplex_pivot_rec(int offset, int left, vector<NodeId> &pivot_candidates, vector<NodeId> &stack,
-			     function<void(NodeSet &)> callback) {
-	if (stack.size() > 0) {
-		NodeSet pivot(stack.begin(), stack.end());
-		callback(pivot);
+NodeSetSet min_bdd_d_set(SGraph &g, int max_del, int d, NodeSet &candidate_set) {
+	AdjMatrix m(g, g.getNodes());
+	NodeSetSet ret;
+
+	for (const Bitset &s : min_bdd_d_set(m, max_del, d, m.toBitset(candidate_set))) {
+		ret.insert(m.toNodeSet(s));
+	}
+
+	return ret;
+}
+
+/*
+ * A vertex v of a pivot set P is not adjacent to the pivot node, so its neighbours in the final k-plex S are in
+ * the candidate set C or in P. At most bdd_max_del = min(max_del, |C| + |P| + 1 - k - 2) vertices are removed
+ * from C + P + pivot node, and S is a k-plex, hence
+ *
+ *	|N(v) & C| + |N(v) & P| >= |S| - k >= max(|C| + |P| + 1 - max_del - k, 2).
+ */
+static int kplex_pivot_required(int k, int max_del, int candidate_size, int pivot_size) {
+	return std::max(candidate_size + pivot_size + 1 - max_del - k, 2);
+}
+
+/* Smallest |N(v) & C| of a vertex v in some pivot set of at most k - 1 vertices, all adjacent to v */
+static int kplex_pivot_min_common(int k, int max_del, int candidate_size) {
+	return kplex_pivot_required(k, max_del, candidate_size, k - 1) - (k - 2);
+}
+
+NodeSet kplex_pivot_reach(SGraph &g, int k, int max_del, NodeId pivot_node, const NodeSet &candidate) {
+	if (k < 2 || kplex_pivot_min_common(k, max_del, candidate.size()) <= 0) {
+		/* Pivot vertices may share no neighbour with the pivot node */
+		return g.getReachableNodes(pivot_node);
+	}
+
+	/* Every pivot vertex has a neighbour in the candidate set */
+	NodeSet reach = candidate;
+	reach.insert(pivot_node);
+	for (NodeId u : candidate) {
+		NodeSet neigh = g.neighbourhood(u);
+		reach.insert(neigh.begin(), neigh.end());
 	}
-	if (left > 0) {
-		for (int i = offset; i <= (int)(pivot_candidates.size()) - left; i++) {
-			stack.push_back(pivot_candidates[i]);
-			foreach_kplex_pivot_rec(i + 1, left - 1, pivot_candidates, stack, callback);
-			stack.pop_back();
+
+	return reach;
+}
+
+NodeSet kplex_seed_pivots(SGraph &g, int k, int c, const NodeSet &seeds) {
+	/* A plex found by a pivot lies within its pivot reach, which spans two hops of it... */
+	NodeSet pivots = g.commonBall(seeds, 2);
+
+	/*
+	 * ...unless the pivot sets may share no neighbour with the pivot node. Trimming removes one candidate per
+	 * deletion, so |C| - max_del = degree - c + 1 throughout, and kplex_pivot_min_common only depends on the
+	 * degree of the pivot node. Such pivots reach their whole component; k < 2 allows no pivot set.
+	 */
+	if (k >= 2 && !seeds.empty()) {
+		for (NodeId u : g.getReachableNodes(*seeds.begin())) {
+			if (kplex_pivot_min_common(k, c - 1, g.degree(u)) <= 0) {
+				pivots.insert(u);
+			}
 		}
 	}
+
+	return pivots;
 }
 
-void foreach_kplex_pivot(int k, NodeSet &pivot_candidates, function<void(NodeSet &)> callback) {
-	vector<NodeId> pivot_candidate_vec(pivot_candidates.begin(), pivot_candidates.end());
-	vector<NodeId> stack;
+struct KplexPivotSearch {
+	SGraph &g;
+	int k, max_del, candidate_size;
+	function<void(NodeSet &)> &callback;
+
+	vector<NodeId> pivot_candidates;
+	vector<int> common;
+
+	/* Current pivot set, as indices into pivot_candidates, and |N(v) & P| of each of its vertices */
+	vector<int> stack;
+	vector<int> adjacent;
+
+	void search(int offset) {
+		int size = (int)(this->stack.size());
+		if (size > 0) {
+			int required = kplex_pivot_required(this->k, this->max_del, this->candidate_size, size);
+			int max_deficit = INT_MIN;
+			for (int j = 0; j < size; j++) {
+				max_deficit =
+				    std::max(max_deficit, required - this->common[this->stack[j]] - this->adjacent[j]);
+			}
+
+			/* Each further pivot vertex decreases a deficit by at most one */
+			if (max_deficit > this->k - 1 - size) {
+				return;
+			}
+			if (max_deficit <= 0) {
+				NodeSet pivot;
+				for (int i : this->stack) {
+					pivot.insert(pivot.end(), this->pivot_candidates[i]);
+				}
+				this->callback(pivot);
+			}
+		}
+
+		if (size < this->k - 1) {
+			for (int i = offset; i < (int)(this->pivot_candidates.size()); i++) {
+				NodeId v = this->pivot_candidates[i];
+				int adj = 0;
+				for (int j = 0; j < size; j++) {
+					if (this->g.hasEdge(v, this->pivot_candidates[this->stack[j]])) {
+						this->adjacent[j]++;
+						adj++;
+					}
+				}
+
+				this->stack.push_back(i);
+				this->adjacent.push_back(adj);
+				this->search(i + 1);
+				this->stack.pop_back();
+				this->adjacent.pop_back();
+
+				for (int j = 0; j < size; j++) {
+					if (this->g.hasEdge(v, this->pivot_candidates[this->stack[j]])) {
+						this->adjacent[j]--;
+					}
+				}
+			}
+		}
+	}
+};
+
+void foreach_kplex_pivot(SGraph &g, int k, int max_del, const NodeSet &candidate, NodeSet &pivot_candidates,
+			 function<void(NodeSet &)> callback) {
+	KplexPivotSearch search{g, k, max_del, (int)(candidate.size()), callback, {}, {}, {}, {}};
+
+	/* Keep the vertices with enough common neighbours with the pivot node only */
+	int min_common = kplex_pivot_min_common(k, max_del, candidate.size());
+	for (NodeId v : pivot_candidates) {
+		int common = g.degree(v, candidate);
+		if (common >= min_common) {
+			search.pivot_candidates.push_back(v);
+			search.common.push_back(common);
+		}
+	}
 
 	/* Empty set is subset of every set */
 	NodeSet empty;
 	callback(empty);
 
-	foreach_kplex_pivot_rec(0, k, pivot_candidate_vec, stack, callback);
-}
\ No newline at end of file
+	search.search(0);
+}
@@ -4,101 +4,156 @@
 #include <unordered_map>
 
 #include <conf.hpp>
+#include <scheduler.hpp>
 
 using std::set_intersection;
 using std::unordered_map;
 
-NodeSetSet min_c_isolated_clique(SGraph &g, int c) {
+typedef unordered_map<NodeSet, NodeId, boost::hash<NodeSet>> CliqueCandidates;
+
+/* Min-c-isolated cliques found by pivot, before the screening stage */
+static vector<NodeSet> min_c_isolated_clique_pivot(SGraph &g, int c, NodeId pivot) {
+	vector<NodeSet> found;
+
+	/* Candidate set */
+	NodeSet candidate = g.neighbourhoodGreaterDeg(pivot);
+	candidate.insert(pivot);
+
+	SGraph search_graph;
+	NodeSetSet enumeration_delete_sets;
+
+	/* Trimming stage */
+	bool fixpoint;
+	int d = 0;
+	int max_vc_size;
+
+	do {
+		if (d >= c) {
+			/* We removed too many vertices, the pivot has c outgoing deg */
+			return found;
+		}
+		fixpoint = true;
+		for (NodeId node : candidate) {
+			/* Invariant (b) */
+			if (g.degree(node, candidate) < (int)(candidate.size()) - c) {
+				candidate.erase(node);
+				d++;
+				fixpoint = false;
+				break;
+			}
+		}
+	} while (!fixpoint);
+
+	/* The pivot must have less than c neighbours outside of the clique */
+	if (g.outdegree(pivot, candidate) >= c) {
+		return found;
+	}
+
+	/* Enumeration stage */
+	search_graph = g.buildComplement(candidate);
+	max_vc_size = c - d - 1;
+
+	enumeration_delete_sets = min_vertex_cover_bounded(search_graph, max_vc_size);
+
+	for (const NodeSet &dset : enumeration_delete_sets) {
+		int dd = d;
+		NodeSet diffset = candidate;
+		for (NodeId u : dset) {
+			diffset.erase(u);
+			dd++;
+		}
+		found.push_back(diffset);
+	}
+
+	return found;
+}
+
+/* Screening stage of the candidates containing seeds, each one keyed by the last pivot finding it */
+static NodeSetSet min_c_isolated_clique_screening(SGraph &g, const CliqueCandidates &screening_candidates,
+						  const NodeSet &seeds) {
 	NodeSetSet sol;
 
-	unordered_map<NodeSet, NodeId, boost::hash<NodeSet>> screening_candidates;
-	/* Forall pivots, we enumerate the max_c_isolated cliques */
-	g.forallNodes(
-	    [&](NodeId pivot) {
-		    /* Candidate set */
-		    NodeSet candidate = g.neighbourhoodGreaterDeg(pivot);
-		    candidate.insert(pivot);
-
-		    SGraph search_graph;
-		    NodeSetSet enumeration_delete_sets;
-
-		    /* Trimming stage */
-		    bool fixpoint;
-		    int d = 0;
-		    int max_vc_size;
-
-		    do {
-			    if (d >= c) {
-				    /* We removed too many vertices, the pivot has c outgoing deg */
-				    goto next_pivot;
-			    }
-			    fixpoint = true;
-			    for (NodeId node : candidate) {
-				    /* Invariant (b) */
-				    if (g.degree(node, candidate) < (int)(candidate.size()) - c) {
-					    candidate.erase(node);
-					    d++;
-					    fixpoint = false;
-					    break;
-				    }
-			    }
-		    } while (!fixpoint);
-
-		    /* The pivot must have less than c neighbours outside of the clique */
-		    if (g.outdegree(pivot, candidate) >= c) {
-			    goto next_pivot;
-		    }
-
-		    /* Enumeration stage */
-		    search_graph = g.buildComplement(candidate);
-		    max_vc_size = c - d - 1;
-
-		    enumeration_delete_sets = min_vertex_cover_bounded(search_graph, max_vc_size);
-
-		    for (const NodeSet &dset : enumeration_delete_sets) {
-			    int dd = d;
-			    NodeSet diffset = candidate;
-			    for (NodeId u : dset) {
-				    diffset.erase(u);
-				    dd++;
-			    }
-#pragma omp critical(screening_candidates)
-			    { screening_candidates[diffset] = pivot; }
-		    }
-	    next_pivot:;
-	    },
-	    parallelism);
-
-	/* Screening stage */
-#pragma omp parallel if (parallelism)
-	{
-#pragma omp single
-		{
-			for (const auto &c1 : screening_candidates) {
-#pragma omp task if (parallelism)
-				{
-					NodeSet vneigh = g.neighbourhoodSmallerDeg(c1.second);
-					bool maximal = true;
-					/* If there is a vertex which is adjacent to all vertices of the clique, the
-					 * clique is not maximal */
-					for (const NodeId &u : vneigh) {
-						NodeSet uneigh = g.neighbourhood(u);
-						NodeSet result;
-						set_intersection(c1.first.begin(), c1.first.end(), uneigh.begin(),
-								 uneigh.end(), std::inserter(result, result.begin()));
-						if (result.size() == c1.first.size()) {
-							maximal = false;
-							break;
-						}
-					}
-
-					if (maximal) {
-#pragma omp critical(sol)
-						sol.insert(c1.first);
-					}
-				}
+	/* Each iteration flags its own candidate */
+	vector<const pair<const NodeSet, NodeId> *> entries;
+	for (const auto &c1 : screening_candidates) {
+		if (std::includes(c1.first.begin(), c1.first.end(), seeds.begin(), seeds.end())) {
+			entries.push_back(&c1);
+		}
+	}
+	vector<char> maximal_flags(entries.size(), 0);
+
+	scheduler::parallel_for((long)(entries.size()), [&](long i) {
+		const auto &c1 = *entries[i];
+		NodeSet vneigh = g.neighbourhoodSmallerDeg(c1.second);
+		bool maximal = true;
+		/* If there is a vertex which is adjacent to all vertices of the clique, the
+		 * clique is not maximal */
+		for (const NodeId &u : vneigh) {
+			NodeSet uneigh = g.neighbourhood(u);
+			NodeSet result;
+			set_intersection(c1.first.begin(), c1.first.end(), uneigh.begin(),
+					 uneigh.end(), std::inserter(result, result.begin()));
+			if (result.size() == c1.first.size()) {
+				maximal = false;
+				break;
 			}
 		}
+
+		maximal_flags[i] = maximal;
+	});
+
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (maximal_flags[i]) {
+			sol.insert(entries[i]->first);
+		}
 	}
+
 	return sol;
-}
\ No newline at end of file
+}
+
+NodeSetSet min_c_isolated_clique(SGraph &g, int c) {
+	CliqueCandidates screening_candidates;
+
+	/* Cliques found by each pivot, indexed by its dense index: every slot is written by a single task */
+	vector<vector<NodeSet>> found(g.getNodesCount());
+	/* Forall pivots, we enumerate the max_c_isolated cliques */
+	g.forallNodes([&](NodeId pivot) { found[g.index(pivot)] = min_c_isolated_clique_pivot(g, c, pivot); },
+		      parallelism);
+
+	/* Merge in pivot order: the last pivot finding a clique is kept, as in a sequential run */
+	for (int i = 0; i < (int)(found.size()); i++) {
+		for (const NodeSet &diffset : found[i]) {
+			screening_candidates[diffset] = g.nodeId(i);
+		}
+	}
+
+	return min_c_isolated_clique_screening(g, screening_candidates, NodeSet());
+}
+
+NodeSetSet min_c_isolated_clique_seeded(SGraph &g, int c, const NodeSet &seeds) {
+	/*
+	 * A clique lies within the neighbourhood of the pivots finding it, so the cliques containing the seeds, and
+	 * the keys their screening reads, come from the pivots adjacent to all of them
+	 */
+	vector<NodeId> pivots;
+	for (NodeId u : g.commonBall(seeds, 1)) {
+		if (g.index(u) >= 0) {
+			pivots.push_back(u);
+		}
+	}
+
+	vector<vector<NodeSet>> found(pivots.size());
+	scheduler::parallel_for((long)(pivots.size()), [&](long slot) {
+		found[slot] = min_c_isolated_clique_pivot(g, c, pivots[slot]);
+	});
+
+	/* Node ids follow the dense indices: pivots are merged in pivot order */
+	CliqueCandidates screening_candidates;
+	for (size_t i = 0; i < pivots.size(); i++) {
+		for (const NodeSet &diffset : found[i]) {
+			screening_candidates[diffset] = pivots[i];
+		}
+	}
+
+	return min_c_isolated_clique_screening(g, screening_candidates, seeds);
+}
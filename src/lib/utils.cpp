@@ -1,25 +1,305 @@
+#include <GraphFile.hpp>
 #include <conf.hpp>
+#include <scheduler.hpp>
 #include <utils.hpp>
 
 #include <algorithm>
-#include <unordered_map>
-#include <unordered_set>
+#include <cerrno>
+#include <cstring>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
 using std::pair;
-using std::unordered_map;
-using std::unordered_set;
 using std::vector;
 
 bool parallelism = false;
 
+/* Bytes of text parsed by a single task */
+#define PARSE_CHUNK (1 << 20)
+
+/* Contacts whose timestamps are mapped by a single task */
+#define MAP_CHUNK (1 << 16)
+
+MappedFile::MappedFile(const string &path) : data(nullptr), length(0), mapping(MAP_FAILED), open(false) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		spdlog::error("Cannot open {}", path);
+		return;
+	}
+	this->open = true;
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		this->mapping = mmap(nullptr, (size_t)(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (this->mapping != MAP_FAILED) {
+			this->length = (size_t)(st.st_size);
+			this->data = (const char *)(this->mapping);
+			madvise(this->mapping, this->length, MADV_SEQUENTIAL);
+		}
+	}
+
+	if (this->mapping == MAP_FAILED) {
+		/* Not a regular file, or mmap is not available: read it whole */
+		char chunk[1 << 16];
+		ssize_t got;
+		while ((got = read(fd, chunk, sizeof(chunk))) > 0) {
+			this->buffer.insert(this->buffer.end(), chunk, chunk + got);
+		}
+		this->length = this->buffer.size();
+		this->data = this->buffer.data();
+	}
+
+	close(fd);
+}
+
+MappedFile::~MappedFile() {
+	if (this->mapping != MAP_FAILED) {
+		munmap(this->mapping, this->length);
+	}
+}
+
+bool MappedFile::isOpen() const {
+	return this->open;
+}
+
+const char *MappedFile::begin() const {
+	return this->data;
+}
+
+const char *MappedFile::end() const {
+	return this->data + this->length;
+}
+
+size_t MappedFile::size() const {
+	return this->length;
+}
+
+static inline bool is_separator(char ch) {
+	return ch == ' ' || ch == '\t' || ch == ',' || ch == '\r';
+}
+
+/*
+ * Scans the line starting at p for fields integers, appending them to out; the line is dropped unless it
+ * starts with a full record. Returns the beginning of the next line.
+ */
+static const char *parse_line(const char *p, const char *end, int fields, vector<int> &out) {
+	size_t mark = out.size();
+	for (int f = 0; f < fields; f++) {
+		while (p < end && is_separator(*p)) {
+			p++;
+		}
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			p++;
+		}
+
+		const char *digits = p;
+		long value = 0;
+		while (p < end && *p >= '0' && *p <= '9') {
+			value = value * 10 + (*p - '0');
+			p++;
+		}
+
+		if (p == digits || (p < end && !is_separator(*p) && *p != '\n')) {
+			out.resize(mark);
+			break;
+		}
+		out.push_back((int)(negative ? -value : value));
+	}
+
+	const char *eol = (const char *)(memchr(p, '\n', end - p));
+	return eol == nullptr ? end : eol + 1;
+}
+
+/*
+ * Values of the records of the file, record by record. The file is split into chunks at line boundaries, which
+ * are parsed in parallel.
+ */
+static vector<int> parse_records(const MappedFile &file, int fields) {
+	const char *begin = file.begin(), *end = file.end();
+	long chunks = (long)(file.size() / PARSE_CHUNK) + 1;
+
+	/* Every chunk starts at a line beginning */
+	vector<const char *> bounds(chunks + 1, end);
+	bounds[0] = begin;
+	for (long i = 1; i < chunks; i++) {
+		const char *p = std::max(begin + i * PARSE_CHUNK, bounds[i - 1]);
+		const char *eol = p < end ? (const char *)(memchr(p, '\n', end - p)) : nullptr;
+		bounds[i] = eol == nullptr ? end : eol + 1;
+	}
+
+	vector<vector<int>> parsed(chunks);
+	scheduler::parallel_for(chunks, [&](long i) {
+		const char *p = bounds[i];
+		while (p < bounds[i + 1]) {
+			p = parse_line(p, bounds[i + 1], fields, parsed[i]);
+		}
+	});
+
+	vector<int> values;
+	if (chunks == 1) {
+		values.swap(parsed[0]);
+		return values;
+	}
+
+	size_t total = 0;
+	for (const vector<int> &chunk : parsed) {
+		total += chunk.size();
+	}
+	values.reserve(total);
+	for (const vector<int> &chunk : parsed) {
+		values.insert(values.end(), chunk.begin(), chunk.end());
+	}
+
+	return values;
+}
+
+ContactStream::ContactStream(const string &path, bool squash, NodeTime sliding_window, NodeTime downsample,
+			     NodeTime max_gap)
+    : at_end(false), squash(squash), sliding_window(sliding_window), downsample(downsample),
+      max_gap(squash ? 0 : max_gap), last_timestamp(0), timestamps(0), instant(0), first_instant(0), prev(0),
+      prev_compressed(0) {
+	this->fd = path == "-" ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY);
+	if (this->fd < 0) {
+		spdlog::error("Cannot open {}", path);
+		this->at_end = true;
+	}
+}
+
+ContactStream::~ContactStream() {
+	if (this->fd > STDIN_FILENO) {
+		close(this->fd);
+	}
+}
+
+void ContactStream::add(NodeTime timestamp, NodeId nodeFrom, NodeId nodeTo) {
+	if (this->timestamps > 0 && timestamp < this->last_timestamp) {
+		spdlog::warn("Contact ({}, {}) at {} is older than the previous one at {}, ignoring it", nodeFrom, nodeTo,
+			     timestamp, this->last_timestamp);
+		return;
+	}
+
+	if (this->timestamps == 0 || timestamp != this->last_timestamp) {
+		/* Same mapping as load_tgraph: squash, downsample, then bridge the gaps */
+		NodeTime t = (this->squash ? this->timestamps : timestamp) / this->downsample;
+		NodeTime compressed = t;
+
+		if (this->max_gap > 0) {
+			if (this->timestamps == 0) {
+				this->timeline.addSegment(t, t);
+			} else if (t == this->prev) {
+				compressed = this->prev_compressed;
+			} else {
+				compressed = t - this->prev <= this->max_gap + 1 ? this->prev_compressed + 1
+										 : this->prev_compressed + (t - this->prev);
+				if (compressed - this->prev_compressed != t - this->prev) {
+					this->timeline.addSegment(compressed, t);
+				}
+			}
+			this->prev = t;
+			this->prev_compressed = compressed;
+		}
+
+		if (this->timestamps == 0) {
+			this->first_instant = compressed;
+		}
+		this->instant = compressed;
+		this->last_timestamp = timestamp;
+		this->timestamps++;
+	}
+
+	/* Extend the last edge of the pair, unless the gap since it is wider than the sliding window */
+	auto it = this->last_edge.find(pair<NodeId, NodeId>(nodeFrom, nodeTo));
+	if (it != this->last_edge.end() && !(this->edges[it->second].tStop + this->sliding_window < this->instant - 1)) {
+		this->edges[it->second].tStop = this->instant;
+	} else {
+		this->last_edge[pair<NodeId, NodeId>(nodeFrom, nodeTo)] = this->edges.size();
+		this->edges.push_back(TEdge(nodeFrom, nodeTo, this->instant, this->instant));
+	}
+}
+
+bool ContactStream::read() {
+	if (this->at_end) {
+		return false;
+	}
+
+	char chunk[1 << 16];
+	ssize_t got;
+	do {
+		got = ::read(this->fd, chunk, sizeof(chunk));
+	} while (got < 0 && errno == EINTR);
+
+	if (got <= 0) {
+		/* Last line without a line end */
+		this->partial.push_back('\n');
+		got = 0;
+		this->at_end = true;
+	}
+	this->partial.insert(this->partial.end(), chunk, chunk + got);
+
+	const char *p = this->partial.data(), *end = p + this->partial.size();
+	const char *last = end;
+	while (last > p && last[-1] != '\n') {
+		last--;
+	}
+
+	vector<int> values;
+	while (p < last) {
+		p = parse_line(p, last, 3, values);
+	}
+	for (size_t i = 0; i + 2 < values.size(); i += 3) {
+		this->add(values[i], values[i + 1], values[i + 2]);
+	}
+	this->partial.erase(this->partial.begin(), this->partial.begin() + (last - this->partial.data()));
+
+	return !this->at_end;
+}
+
+bool ContactStream::empty() const {
+	return this->timestamps == 0;
+}
+
+NodeTime ContactStream::first() const {
+	return this->first_instant;
+}
+
+NodeTime ContactStream::complete() const {
+	/*
+	 * Later contacts are at this instant or after it: they may extend an edge ending at least
+	 * sliding_window + 1 instants before them, filling the instants in between.
+	 */
+	return this->at_end ? this->instant : this->instant - this->sliding_window - 1;
+}
+
+TGraph ContactStream::graph() const {
+	vector<TEdge> edge_list = this->edges;
+	return TGraph(edge_list);
+}
+
+const Timeline &ContactStream::getTimeline() const {
+	return this->timeline;
+}
+
 SGraph load_sgraph(string path) {
-	ifstream in(path);
-	vector<SEdge> edge_list;
-	SEdge e;
+	GraphFileHeader header;
+	if (read_graph_file_header(path, header)) {
+		return load_sgraph_file(path);
+	}
 
-	while (in >> e.nodeFrom >> e.nodeTo) {
-		edge_list.push_back(e);
+	MappedFile file(path);
+	vector<int> values = parse_records(file, 2);
+	vector<SEdge> edge_list(values.size() / 2);
+
+	for (size_t i = 0; i < edge_list.size(); i++) {
+		edge_list[i] = SEdge(values[2 * i], values[2 * i + 1]);
 	}
 
 	return SGraph(edge_list);
@@ -41,52 +321,196 @@ TGraph load_tgraph(string path) {
 }
 
 TGraph load_tgraph(string path, bool squash, NodeTime sliding_window, NodeTime downsample) {
-	ifstream in(path);
-	vector<TEdge> edge_list;
-	unordered_map<pair<NodeId, NodeId>, vector<NodeTime>, boost::hash<pair<NodeId, NodeId>>> edge_map;
-	set<NodeTime> timestamps;
-	unordered_map<NodeTime, NodeTime> timestamps_map;
+	Timeline timeline;
+	return load_tgraph(path, squash, sliding_window, downsample, 0, timeline);
+}
+
+void Timeline::addSegment(NodeTime compressed, NodeTime original) {
+	this->segments.push_back(pair<NodeTime, NodeTime>(compressed, original));
+}
+
+NodeTime Timeline::original(NodeTime t) const {
+	auto it = std::upper_bound(this->segments.begin(), this->segments.end(), t,
+				   [](NodeTime t, const pair<NodeTime, NodeTime> &s) { return t < s.first; });
+	if (it == this->segments.begin()) {
+		return t;
+	}
+	it--;
+
+	return it->second + (t - it->first);
+}
+
+Interval Timeline::original(const Interval &interval) const {
+	return Interval(this->original(interval.first), this->original(interval.second));
+}
+
+NodeTime Timeline::compressed(NodeTime t, bool next) const {
+	auto it = std::upper_bound(this->segments.begin(), this->segments.end(), t,
+				   [](NodeTime t, const pair<NodeTime, NodeTime> &s) { return t < s.second; });
+	if (it == this->segments.begin()) {
+		return t;
+	}
+
+	/* Segment i covers the compressed instants up to the first one of segment i + 1 */
+	NodeTime compressed = (it - 1)->first + (t - (it - 1)->second);
+	if (it != this->segments.end() && compressed >= it->first) {
+		return next ? it->first : it->first - 1;
+	}
+
+	return compressed;
+}
+
+const vector<pair<NodeTime, NodeTime>> &Timeline::getSegments() const {
+	return this->segments;
+}
 
+struct Contact {
 	NodeId nodeFrom, nodeTo;
-	NodeTime timestamp;
+	NodeTime t;
+};
 
-	while (in >> timestamp >> nodeFrom >> nodeTo) {
-		edge_map[pair<NodeId, NodeId>(nodeFrom, nodeTo)].push_back(timestamp);
-		timestamps.insert(timestamp);
+/*
+ * LSD radix sort of the contacts by (nodeFrom, nodeTo, t), on 16-bit digits. Passes where every contact has the
+ * same digit, e.g. the high halves of small ids, are skipped.
+ */
+static void radix_sort(vector<Contact> &contacts) {
+	vector<Contact> sorted(contacts.size());
+	vector<size_t> count(1 << 16);
+
+	for (int pass = 0; pass < 6; pass++) {
+		auto digit = [pass](const Contact &c) {
+			int key = pass < 2 ? c.t : (pass < 4 ? c.nodeTo : c.nodeFrom);
+			/* Flip the sign bit, so that negative keys come first */
+			unsigned int bits = (unsigned int)(key) ^ 0x80000000u;
+			return (bits >> (16 * (pass % 2))) & 0xffff;
+		};
+
+		std::fill(count.begin(), count.end(), 0);
+		for (const Contact &c : contacts) {
+			count[digit(c)]++;
+		}
+		if (contacts.empty() || count[digit(contacts[0])] == contacts.size()) {
+			continue;
+		}
+
+		size_t offset = 0;
+		for (size_t &cnt : count) {
+			size_t next = offset + cnt;
+			cnt = offset;
+			offset = next;
+		}
+		for (const Contact &c : contacts) {
+			sorted[count[digit(c)]++] = c;
+		}
+		contacts.swap(sorted);
 	}
+}
 
-	if (squash) {
-		NodeTime next_timestamp = 0;
-		for (NodeTime t : timestamps) {
-			timestamps_map[t] = next_timestamp++;
+TGraph load_tgraph(string path, bool squash, NodeTime sliding_window, NodeTime downsample, NodeTime max_gap,
+		   Timeline &timeline) {
+	GraphFileHeader header;
+	if (read_graph_file_header(path, header)) {
+		return load_tgraph_file(path, squash, sliding_window, downsample, max_gap, timeline);
+	}
+
+	vector<TEdge> edge_list;
+	vector<Contact> contacts;
+
+	{
+		MappedFile file(path);
+		vector<int> values = parse_records(file, 3);
+		contacts.resize(values.size() / 3);
+		scheduler::parallel_for((long)(contacts.size()), [&](long i) {
+			contacts[i] = Contact{values[3 * i + 1], values[3 * i + 2], values[3 * i]};
+		});
+	}
+
+	/* Distinct timestamps: traces are usually sorted by time, so consecutive duplicates are dropped first */
+	vector<NodeTime> timestamps;
+	for (const Contact &c : contacts) {
+		if (timestamps.empty() || timestamps.back() != c.t) {
+			timestamps.push_back(c.t);
 		}
+	}
+	if (!std::is_sorted(timestamps.begin(), timestamps.end())) {
+		std::sort(timestamps.begin(), timestamps.end());
+	}
+	timestamps.erase(std::unique(timestamps.begin(), timestamps.end()), timestamps.end());
+
+	/* Final instant of every distinct timestamp: squashing numbers them, then they are downsampled */
+	vector<NodeTime> instant(timestamps.size());
+	for (size_t i = 0; i < timestamps.size(); i++) {
+		instant[i] = (squash ? (NodeTime)(i) : timestamps[i]) / downsample;
+	}
 
-		for (auto &val : edge_map) {
-			for (auto it = val.second.begin(); it < val.second.end(); it++) {
-				*it = timestamps_map[*it];
+	/*
+	 * Bridge the gaps: an instant following the previous timestamp by at most max_gap + 1 instants becomes the
+	 * next compressed instant, while longer gaps are kept as they are.
+	 */
+	if (max_gap > 0 && !squash) {
+		NodeTime prev = 0, prev_compressed = 0;
+		bool first = true;
+		for (size_t i = 0; i < instant.size(); i++) {
+			NodeTime t = instant[i];
+			if (!first && t == prev) {
+				instant[i] = prev_compressed;
+				continue;
 			}
+
+			NodeTime compressed = t;
+			if (!first) {
+				if (t - prev <= max_gap + 1) {
+					compressed = prev_compressed + 1;
+				} else {
+					compressed = prev_compressed + (t - prev);
+				}
+			}
+
+			if (first || compressed - prev_compressed != t - prev) {
+				timeline.addSegment(compressed, t);
+			}
+
+			instant[i] = compressed;
+			prev = t;
+			prev_compressed = compressed;
+			first = false;
 		}
 	}
 
-	for (auto &val : edge_map) {
-		for (auto it = val.second.begin(); it < val.second.end(); it++) {
-			*it /= downsample;
+	/* Blocks of consecutive contacts mostly share their timestamps: remember the last one looked up */
+	scheduler::parallel_for(((long)(contacts.size()) + MAP_CHUNK - 1) / MAP_CHUNK, [&](long block) {
+		size_t begin = block * MAP_CHUNK, end = std::min(begin + MAP_CHUNK, contacts.size());
+		NodeTime last = 0, mapped = 0;
+		for (size_t i = begin; i < end; i++) {
+			if (i == begin || contacts[i].t != last) {
+				last = contacts[i].t;
+				mapped = instant[std::lower_bound(timestamps.begin(), timestamps.end(), last) - timestamps.begin()];
+			}
+			contacts[i].t = mapped;
 		}
-		std::sort(val.second.begin(), val.second.end());
+	});
 
-		NodeTime start_time = val.second[0], last_time = val.second[0];
+	/* Group the instants of every (nodeFrom, nodeTo) pair, sorted: the map above is non-decreasing */
+	radix_sort(contacts);
 
-		for (unsigned int i = 1; i < val.second.size(); i++) {
-			if (last_time + sliding_window < val.second[i] - 1) {
-				edge_list.push_back(TEdge(val.first.first, val.first.second, start_time, last_time));
-				start_time = last_time = val.second[i];
+	for (size_t begin = 0, end; begin < contacts.size(); begin = end) {
+		const Contact &c = contacts[begin];
+		NodeTime start_time = c.t, last_time = c.t;
+
+		for (end = begin + 1; end < contacts.size() && contacts[end].nodeFrom == c.nodeFrom &&
+				      contacts[end].nodeTo == c.nodeTo;
+		     end++) {
+			NodeTime t = contacts[end].t;
+			if (last_time + sliding_window < t - 1) {
+				edge_list.push_back(TEdge(c.nodeFrom, c.nodeTo, start_time, last_time));
+				start_time = last_time = t;
 			} else {
-				last_time = val.second[i];
+				last_time = t;
 			}
 		}
 
-		edge_list.push_back(TEdge(val.first.first, val.first.second, start_time, last_time));
+		edge_list.push_back(TEdge(c.nodeFrom, c.nodeTo, start_time, last_time));
 	}
 
 	return TGraph(edge_list);
-}
\ No newline at end of file
+}
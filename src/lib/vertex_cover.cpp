@@ -2,63 +2,107 @@
 
 #include <cassert>
 
-using std::shared_ptr;
+/*
+ * Bounded search tree over the uncovered edges. alive holds the vertices out of the cover, so an edge is
+ * uncovered iff both its endpoints are alive, and the residual degree of an alive vertex is the number of its
+ * alive neighbours.
+ *
+ * Every vertex whose residual degree exceeds the budget left belongs to every cover within the budget (Buss
+ * kernel). Then the vertex u of highest residual degree is either in the cover, or out of it with all its
+ * alive neighbours in. Both branches enumerate disjoint families of covers: once u is out, its residual degree
+ * is zero and it is never added back.
+ */
+static void min_vertex_cover_branch(const AdjMatrix &g, Bitset &alive, int left, BitsetSet &result) {
+	int u, max_deg;
+	bool kernel = true;
 
-bool is_vertex_cover(vector<NodeId> &elems, SGraph &g);
+	while (kernel) {
+		kernel = false;
+		u = -1;
+		max_deg = 0;
+		long edges = 0;
 
-void min_vertex_cover_rec(int offset, int left, vector<NodeId> &elems, NodeSetSet &result, SGraph &g);
+		for (int v = 0; v < g.size(); v++) {
+			if (!alive.test(v)) {
+				continue;
+			}
 
-bool is_vertex_cover(vector<NodeId> &elems, SGraph &g) {
-	NodeSet covered;
-	covered.insert(elems.begin(), elems.end());
-	for (NodeId u : elems) {
-		g.forallNeighbours(u, [&](NodeId v) { covered.insert(v); }, false);
+			int deg = g.degree(v, alive);
+			if (deg > left) {
+				/* Forced in the cover */
+				alive.reset(v);
+				left--;
+				kernel = true;
+				break;
+			}
+
+			edges += deg;
+			if (deg > max_deg) {
+				max_deg = deg;
+				u = v;
+			}
+		}
+
+		if (left < 0) {
+			return;
+		}
+
+		/* Each vertex in the cover covers at most max_deg of the remaining edges */
+		if (!kernel && edges / 2 > (long)left * max_deg) {
+			return;
+		}
 	}
 
-#ifdef DEBUG_SCLIQUE
-	assert((int)(covered.size()) <= g.getNodesCount());
-#endif
+	if (u < 0) {
+		/* Every edge is covered: keep the cover if no vertex in it is redundant */
+		Bitset cover = alive;
+		cover.flip();
 
-	return (int)(covered.size()) == g.getNodesCount();
-}
+		bool minimal = true;
+		cover.forall([&](int v) {
+			if (minimal && g.degree(v, alive) == 0) {
+				minimal = false;
+			}
+		});
 
-void min_vertex_cover_rec(int offset, int left, vector<NodeId> &stack, vector<NodeId> &elems, NodeSetSet &result,
-			  SGraph &g) {
-	if (is_vertex_cover(stack, g)) {
-		/* Add to solution set and prune */
-		result.insert(NodeSet(stack.begin(), stack.end()));
-	} else if (left > 0) {
-		for (int i = offset; i <= (int)(elems.size()) - left; i++) {
-			stack.push_back(elems[i]);
-			min_vertex_cover_rec(i + 1, left - 1, stack, elems, result, g);
-			stack.pop_back();
+		if (minimal) {
+			result.insert(cover);
 		}
+		return;
+	}
+
+	/* u in the cover */
+	if (left > 0) {
+		Bitset alive_in = alive;
+		alive_in.reset(u);
+		min_vertex_cover_branch(g, alive_in, left - 1, result);
+	}
+
+	/* u out of the cover: its alive neighbours are in */
+	Bitset neigh = g.row(u);
+	neigh &= alive;
+	if (max_deg <= left) {
+		Bitset alive_out = alive;
+		alive_out -= neigh;
+		min_vertex_cover_branch(g, alive_out, left - max_deg, result);
 	}
 }
 
 NodeSetSet min_vertex_cover_bounded(SGraph &g, int c) {
-	NodeSet nodes = g.getNodes();
-	vector<NodeId> nodes_v;
-	vector<NodeId> stack;
+	AdjMatrix local(g, g.getNodes());
+	BitsetSet covers;
 	NodeSetSet result;
 
-	/* Add only nodes that have degree > 0 */
-	for (const auto &u : nodes) {
-		if (g.degree(u, nodes) > 0) {
-			nodes_v.push_back(u);
-		}
-	}
-
-	if (nodes_v.size() > 0) {
 #ifdef DEBUG_SCLIQUE
-		assert(nodes.size() > 0);
-		assert(nodes_v.size() <= nodes.size());
-		assert(c >= 0);
+	assert(c >= 0);
 #endif
 
-		min_vertex_cover_rec(0, c, stack, nodes_v, result, g);
-	} else {
-		result.insert(NodeSet());
+	Bitset alive(local.size());
+	alive.fill();
+	min_vertex_cover_branch(local, alive, c, covers);
+
+	for (const Bitset &cover : covers) {
+		result.insert(local.toNodeSet(cover));
 	}
 
 	return result;
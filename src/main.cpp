@@ -24,7 +24,107 @@ const string help_str =
     "k.\n-m:\tSearch min-c-isolated communities\n-M:\tSearch max-c-isolated communities\n-a:\tSearch avg-c-isolated "
     "communities\n-p:\tEnable parallelism\n-v:\tVerbose logging\n-V:\tVery verbose logging\n-T <algorithm>: temporal "
     "graph analysis\n-s:\tSquash temporal dataset\n-D <n>: downsample temporal dataset\n-w <n>: sliding window for "
-    "temporal dataset\n-o <path>: output file\n-X:\t Test output correctness";
+    "temporal dataset\n-g <n>: bridge gaps of at most n empty instants in temporal dataset\n-o <path>: output "
+    "file\n-S:\t Stream the temporal dataset (\"-\" for the standard input), reporting each solution once final; the "
+    "output file holds one solution per line\n-t <from>:<to>: restrict the temporal analysis to the instants "
+    "within [from, to], in the time units of the reported intervals\n-q <node>[,<node>...]: only report the communities "
+    "containing every given node\n-b <path>: convert the dataset, after preprocessing, to a binary graph file and exit\n-X:\t Test output "
+    "correctness";
+
+static bool parse_isolation_type(const string &name, TemporalIsolationType &type) {
+	if (name == "alltime-max") {
+		type = ALLTIME_MAX;
+	} else if (name == "usually-avg") {
+		type = USUALLY_AVG;
+	} else if (name == "alltime-avg") {
+		type = ALLTIME_AVG;
+	} else if (name == "usually-max") {
+		type = USUALLY_MAX;
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+/* Seeds as a comma-separated list of node ids */
+static bool parse_seeds(const char *list, NodeSet &seeds) {
+	const char *p = list;
+	while (true) {
+		char *end;
+		long u = strtol(p, &end, 10);
+		if (end == p) {
+			return false;
+		}
+		seeds.insert((NodeId)(u));
+
+		if (*end == '\0') {
+			return true;
+		} else if (*end != ',') {
+			return false;
+		}
+		p = end + 1;
+	}
+}
+
+/* Streaming mode: the graph is rebuilt from the contacts read whenever more instants are complete */
+static int stream_temporal(const string &dataset, const string &output, bool squash, int sliding_window,
+			   int downsample, int max_gap, int k, int c, TemporalIsolationType type) {
+	ContactStream stream(dataset, squash, sliding_window, downsample, max_gap);
+	TemporalKplexStream engine(k, c, type);
+
+	ofstream out;
+	if (!output.empty()) {
+		out.open(output);
+	}
+
+	auto begin = std::chrono::high_resolution_clock::now();
+	NodeTime next = 0;
+	bool started = false, more = true;
+	int i = 0;
+
+	while (more) {
+		more = stream.read();
+		if (stream.empty()) {
+			continue;
+		}
+		if (!started) {
+			next = stream.first();
+			started = true;
+		}
+
+		NodeSetIntervalSet found;
+		if (next <= stream.complete()) {
+			TGraph g = stream.graph();
+			for (; next <= stream.complete(); next++) {
+				engine.extend(g, next, found);
+			}
+		}
+		if (!more) {
+			engine.finish(found);
+		}
+
+		/* Intervals are reported in the time units of the dataset, before bridging the gaps */
+		for (const NodeSetInterval &sol : found) {
+			Interval interval = stream.getTimeline().original(sol.second);
+			spdlog::info("k-plex #{}: {}", i++, nodesetinterval_to_string(NodeSetInterval(sol.first, interval)));
+
+			if (out.is_open()) {
+				out << interval.first << " " << interval.second << " " << sol.first.size();
+				for (NodeId u : sol.first) {
+					out << " " << u;
+				}
+				out << std::endl;
+			}
+		}
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	auto duration_us = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / 1000;
+	spdlog::info("Stream {} ended, {}-isolation returned {} {}-plexes. Took {} us", dataset, c, i, k, duration_us);
+
+	return 0;
+}
 
 int main(int argc, char **argv) {
 	spdlog::set_level(spdlog::level::info);
@@ -39,13 +139,19 @@ int main(int argc, char **argv) {
 
 	bool temporal = false;
 	bool squash = false;
+	bool streaming = false;
 	bool check = false;
 	bool print_output = false;
+	string binary_output;
 	int downsample = 1;
 	int sliding_window = 0;
+	int max_gap = 0;
 	string temporal_algo;
+	bool windowed = false;
+	NodeTime t_from = NODETIME_MIN, t_to = NODETIME_MAX;
+	NodeSet seeds;
 
-	while ((opt = getopt(argc, argv, "d:c:k:mMaCpvVhT:D:sw:o:X")) != -1) {
+	while ((opt = getopt(argc, argv, "d:c:k:mMaCpvVhT:D:sSw:g:o:b:t:q:X")) != -1) {
 		switch (opt) {
 		case 'h':
 			std::cout << help_str << std::endl;
@@ -88,16 +194,38 @@ int main(int argc, char **argv) {
 		case 's':
 			squash = true;
 			break;
+		case 'S':
+			streaming = true;
+			break;
 		case 'D':
 			downsample = atoi(optarg);
 			break;
 		case 'w':
 			sliding_window = atoi(optarg);
 			break;
+		case 'g':
+			max_gap = atoi(optarg);
+			break;
 		case 'o':
 			output = string(optarg);
 			print_output = true;
 			break;
+		case 'b':
+			binary_output = string(optarg);
+			break;
+		case 't':
+			if (sscanf(optarg, "%d:%d", &t_from, &t_to) != 2 || t_from > t_to) {
+				spdlog::error("Time window {} is not of the form <from>:<to>, with from <= to", optarg);
+				return 1;
+			}
+			windowed = true;
+			break;
+		case 'q':
+			if (!parse_seeds(optarg, seeds)) {
+				spdlog::error("Seed list {} is not a comma-separated list of nodes", optarg);
+				return 1;
+			}
+			break;
 		case 'X':
 			check = true;
 			break;
@@ -120,7 +248,36 @@ int main(int argc, char **argv) {
 	if (temporal) {
 		NodeSetIntervalSet res;
 
-		TGraph g = load_tgraph(dataset, squash, sliding_window, downsample);
+		if (squash && max_gap > 0) {
+			spdlog::warn("Squashed datasets have no gaps, ignoring -g {}", max_gap);
+		}
+
+		TemporalIsolationType type = ALLTIME_MAX;
+		if (!parse_isolation_type(temporal_algo, type) && binary_output.empty()) {
+			spdlog::error("Isolation type {} not supported", temporal_algo);
+			return 1;
+		}
+
+		if (streaming && windowed) {
+			spdlog::error("Time windows are not supported in streaming mode");
+			return 1;
+		}
+
+		if (streaming && !seeds.empty()) {
+			spdlog::error("Seeded queries are not supported in streaming mode");
+			return 1;
+		}
+
+		if (streaming) {
+			return stream_temporal(dataset, output, squash, sliding_window, downsample, max_gap, k, c, type);
+		}
+
+		if (!graph_file_compatible(dataset, true, squash, sliding_window, downsample, max_gap)) {
+			return 1;
+		}
+
+		Timeline timeline;
+		TGraph g = load_tgraph(dataset, squash, sliding_window, downsample, max_gap, timeline);
 
 #if 0
 		auto adj = g.getAdjacencyList();
@@ -137,21 +294,26 @@ int main(int argc, char **argv) {
 			     g.getNodesCount(), g.getEdgesCount(), g.getEdgesInstantsCount(), g.getLifetimeBegin(),
 			     g.getLifetimeEnd());
 
-		TemporalIsolationType type;
-		if (temporal_algo == "alltime-max") {
-			type = ALLTIME_MAX;
-		} else if (temporal_algo == "usually-avg") {
-			type = USUALLY_AVG;
-		} else if (temporal_algo == "alltime-avg") {
-			type = ALLTIME_AVG;
-		} else if (temporal_algo == "usually-max") {
-			type = USUALLY_MAX;
+		if (!binary_output.empty()) {
+			if (!save_tgraph(g, binary_output, squash, sliding_window, downsample, max_gap, timeline)) {
+				spdlog::error("Cannot write graph file {}", binary_output);
+				return 1;
+			}
+			spdlog::info("Graph has been written to graph file {}.", binary_output);
+			return 0;
+		}
+
+		if (windowed) {
+			/* The window is given in the time units of the reported intervals */
+			t_from = timeline.compressed(t_from, true);
+			t_to = timeline.compressed(t_to, false);
 		} else {
-			spdlog::error("Isolation type {} not supported", temporal_algo);
-			return 1;
+			t_from = g.getLifetimeBegin();
+			t_to = g.getLifetimeEnd();
 		}
+
 		auto begin = std::chrono::high_resolution_clock::now();
-		res = c_isolated_temporal_kplex(g, k, c, type);
+		res = c_isolated_temporal_kplex(g, k, c, type, t_from, t_to, seeds);
 		auto end = std::chrono::high_resolution_clock::now();
 
 		auto duration_us = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / 1000;
@@ -159,9 +321,11 @@ int main(int argc, char **argv) {
 		spdlog::info("Graph {}, {}-{}-isolation returned {} {}-plexes. Took {} us", dataset,
 			     temporal_algo, c, res.size(), k, duration_us);
 
+		/* Intervals are reported in the time units of the dataset, before bridging the gaps */
 		int i = 0;
 		for (auto sol : res) {
-			spdlog::info("k-plex #{}: {}", i++, nodesetinterval_to_string(sol));
+			spdlog::info("k-plex #{}: {}", i++,
+				     nodesetinterval_to_string(NodeSetInterval(sol.first, timeline.original(sol.second))));
 		}
 
 		bool check_errors = false;
@@ -174,7 +338,8 @@ int main(int argc, char **argv) {
 			// #returned k-plex
 			out << res.size() << std::endl;
 			for (auto sol : res) {
-				out << sol.second.first << " " << sol.second.second << " " << sol.first.size();
+				Interval interval = timeline.original(sol.second);
+				out << interval.first << " " << interval.second << " " << sol.first.size();
 				for (NodeId u : sol.first) {
 					out << " " << u;
 				}
@@ -211,6 +376,21 @@ int main(int argc, char **argv) {
 			return 1;
 		}
 
+		if (!graph_file_compatible(dataset, false, false, 0, 1, 0)) {
+			return 1;
+		}
+
+		if (!binary_output.empty()) {
+			SGraph g = load_sgraph(dataset);
+			spdlog::info("Input graph has {} nodes and {} edges", g.getNodesCount(), g.getEdgesCount());
+			if (!save_sgraph(g, binary_output)) {
+				spdlog::error("Cannot write graph file {}", binary_output);
+				return 1;
+			}
+			spdlog::info("Graph has been written to graph file {}.", binary_output);
+			return 0;
+		}
+
 		if (c < 1) {
 			spdlog::error("The isolation factor c is a mandatory flag and shall be a positive number");
 			return 1;
@@ -227,7 +407,8 @@ int main(int argc, char **argv) {
 		if (clique) {
 			if (min_c_isolation) {
 				spdlog::info("Running clique min-{}-isolation", c);
-				auto res = min_c_isolated_clique(g, c);
+				auto res = seeds.empty() ? min_c_isolated_clique(g, c)
+							 : min_c_isolated_clique_seeded(g, c, seeds);
 				spdlog::info("{} maximal min-{}-isolated cliques found.", res.size(), c);
 
 				int i = 1;
@@ -237,7 +418,8 @@ int main(int argc, char **argv) {
 			}
 			if (max_c_isolation) {
 				spdlog::info("Running clique max-{}-isolation", c);
-				auto res = max_c_isolated_clique(g, c);
+				auto res = seeds.empty() ? max_c_isolated_clique(g, c)
+							 : max_c_isolated_clique_seeded(g, c, seeds);
 				spdlog::info("{} maximal max-{}-isolated cliques found.", res.size(), c);
 
 				int i = 1;
@@ -251,7 +433,8 @@ int main(int argc, char **argv) {
 		} else {
 			if (min_c_isolation) {
 				spdlog::info("Running {}-plex min-{}-isolation", k, c);
-				auto res = min_c_isolated_kplex(g, c, k);
+				auto res = seeds.empty() ? min_c_isolated_kplex(g, c, k)
+							 : min_c_isolated_kplex_seeded(g, c, k, seeds);
 				spdlog::info("{} maximal min-{}-isolated {}-plexes found.", res.size(), c, k);
 
 				int i = 1;
@@ -261,7 +444,8 @@ int main(int argc, char **argv) {
 			}
 			if (max_c_isolation) {
 				spdlog::info("Running {}-plex max-{}-isolation", k, c);
-				auto res = max_c_isolated_kplex(g, c, k);
+				auto res = seeds.empty() ? max_c_isolated_kplex(g, c, k)
+							 : max_c_isolated_kplex_seeded(g, c, k, g.getNodes(), seeds);
 				spdlog::info("{} maximal max-{}-isolated {}-plex found.", res.size(), c, k);
 
 				int i = 1;
@@ -271,7 +455,8 @@ int main(int argc, char **argv) {
 			}
 			if (avg_c_isolation) {
 				spdlog::info("Running {}-plex avg-{}-isolation", k, c);
-				auto res = avg_c_isolated_kplex(g, c, k);
+				auto res = seeds.empty() ? avg_c_isolated_kplex(g, c, k)
+							 : avg_c_isolated_kplex_seeded(g, c, k, g.getNodes(), seeds);
 				spdlog::info("{} maximal avg-{}-isolated {}-plex found.", res.size(), c, k);
 
 				int i = 1;